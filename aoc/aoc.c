@@ -0,0 +1,256 @@
+#define _GNU_SOURCE
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "days.h"
+#include "pool.h"
+
+enum { PARSE, PART1, PART2, TASKS };
+
+static const char *task_names[TASKS] = { "parse", "part1", "part2" };
+
+struct job;
+
+struct task
+{
+	struct job *job;
+	int n;			/* PARSE, PART1 or PART2 */
+	int ran;
+
+	char *output;		/* captured answer or error */
+	size_t size;
+	int status;
+	int worker;		/* -1 outside of the pool */
+	double start;
+	double end;
+};
+
+struct job
+{
+	const struct solver *s;
+	char *path;
+	struct pool *pool;	/* NULL to run everything in place */
+
+	void *data;
+	atomic_int parts;	/* parts left before the data is freed */
+	struct task tasks[TASKS];
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void task_part(void *arg)
+{
+	struct task *t = arg;
+	struct job *j = t->job;
+	t->start = now();
+	t->worker = j->pool ? pool_worker(j->pool) : -1;
+	t->ran = 1;
+	t->status = -1;
+
+	FILE *output = open_memstream(&t->output, &t->size);
+	if (output)
+	{
+		t->status = solver_part(j->s, t->n, j->data, output);
+		fclose(output);
+	}
+	if (atomic_fetch_sub(&j->parts, 1) == 1)
+	{
+		j->s->free(j->data);
+		j->data = NULL;
+	}
+	t->end = now();
+}
+
+/*
+ * Parse the input, then queue the parts. Parts of the same day run
+ * side by side unless the solver is serial.
+ */
+static void task_parse(void *arg)
+{
+	struct task *t = arg;
+	struct job *j = t->job;
+	t->start = now();
+	t->worker = j->pool ? pool_worker(j->pool) : -1;
+	t->ran = 1;
+	t->status = -1;
+
+	FILE *output = open_memstream(&t->output, &t->size);
+	if (!output)
+	{
+		t->end = now();
+		return;
+	}
+	FILE *input = fopen(j->path, "rb");
+	if (!input)
+	{
+		fprintf(output, "Cannot open %s\n", j->path);
+	}
+	else
+	{
+		j->data = j->s->parse(input);
+		if (!j->data)
+		{
+			fprintf(output, "Cannot parse %s\n", j->path);
+		}
+		fclose(input);
+	}
+	fclose(output);
+	t->end = now();
+	if (!j->data)
+	{
+		return;
+	}
+	t->status = 0;
+
+	int parts = j->s->part2 ? 2 : 1;
+	atomic_init(&j->parts, parts);
+	int serial = !j->pool || (j->s->flags & SOLVER_SERIAL);
+	for (int i = PART1; i < PART1 + parts; i++)
+	{
+		if (serial || pool_submit(j->pool, task_part, j->tasks + i) < 0)
+		{
+			task_part(j->tasks + i);
+		}
+	}
+}
+
+/* day or day=path, the default input is dayN/input */
+static int job_init(struct job *j, const char *arg)
+{
+	memset(j, 0, sizeof(*j));
+	char name[16];
+	const char *eq = strchr(arg, '=');
+	size_t len = eq ? (size_t)(eq - arg) : strlen(arg);
+	if (len >= sizeof(name))
+	{
+		return -1;
+	}
+	memcpy(name, arg, len);
+	name[len] = 0;
+
+	j->s = day_find(name);
+	if (!j->s)
+	{
+		return -1;
+	}
+	for (int i = 0; i < TASKS; i++)
+	{
+		j->tasks[i].job = j;
+		j->tasks[i].n = i;
+	}
+
+	if (eq)
+	{
+		j->path = strdup(eq + 1);
+	}
+	else if (asprintf(&j->path, "%s/input", name) < 0)
+	{
+		j->path = NULL;
+	}
+	return j->path ? 0 : -1;
+}
+
+/* latency of the whole day, from the start of the parse to the last part */
+static double job_latency(const struct job *j)
+{
+	double end = 0;
+	for (int i = 0; i < TASKS; i++)
+	{
+		if (j->tasks[i].ran && end < j->tasks[i].end)
+		{
+			end = j->tasks[i].end;
+		}
+	}
+	return end - j->tasks[PARSE].start;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t threads = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "j:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'j':
+			threads = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-j threads] [day[=input]...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	/* without arguments run every day on its default input */
+	size_t count = optind < argc ? (size_t)(argc - optind) : day_count;
+	struct job *jobs = calloc(count, sizeof(jobs[0]));
+	if (!jobs)
+	{
+		fprintf(stderr, "Cannot allocate the jobs\n");
+		return 1;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		const char *arg = optind < argc ? argv[optind + i] : days[i]->name;
+		if (job_init(jobs + i, arg) < 0)
+		{
+			fprintf(stderr, "Unknown day %s\n", arg);
+			return 1;
+		}
+	}
+
+	/* one thread runs everything in place, in order */
+	double start = now();
+	struct pool *pool = threads != 1 ? pool_new(threads) : NULL;
+	for (size_t i = 0; i < count; i++)
+	{
+		jobs[i].pool = pool;
+		if (!pool || pool_submit(pool, task_parse, jobs[i].tasks + PARSE) < 0)
+		{
+			task_parse(jobs[i].tasks + PARSE);
+		}
+	}
+	pool_free(pool);
+	double makespan = now() - start;
+
+	int failed = 0;
+	for (struct job *j = jobs; j < jobs + count; j++)
+	{
+		printf("%s (%.3f s):\n", j->s->name, job_latency(j));
+		for (struct task *t = j->tasks; t < j->tasks + TASKS; t++)
+		{
+			fwrite(t->output, 1, t->size, stdout);
+			failed |= t->ran && t->status < 0;
+		}
+	}
+
+	double work = 0;
+	printf("\nTask         worker    start  latency\n");
+	for (struct job *j = jobs; j < jobs + count; j++)
+	{
+		for (struct task *t = j->tasks; t < j->tasks + TASKS; t++)
+		{
+			if (t->ran)
+			{
+				printf("%-6s %-5s %6d %8.3f %8.3f\n", j->s->name,
+				       task_names[t->n], t->worker,
+				       t->start - start, t->end - t->start);
+				work += t->end - t->start;
+			}
+			free(t->output);
+		}
+		free(j->path);
+	}
+	printf("Makespan: %.3f s, work: %.3f s\n", makespan, work);
+	free(jobs);
+	return failed;
+}
@@ -0,0 +1,380 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "days.h"
+
+struct entry
+{
+	char day[16];		/* name of the day */
+	char path[4096];	/* registered input */
+};
+
+struct registry
+{
+	struct entry *pool;
+	size_t count;
+	size_t size;
+};
+
+struct sample
+{
+	uint64_t ns;		/* wall time */
+	uint64_t cycles;	/* cpu cycles, or reference cycles */
+	long maxrss;		/* peak resident set in KiB */
+};
+
+static int registry_load(struct registry *r, FILE *input)
+{
+	memset(r, 0, sizeof(*r));
+	char *line = NULL;
+	size_t sline = 0;
+	while (getline(&line, &sline, input) != -1)
+	{
+		struct entry e;
+		if (line[0] == '#' || sscanf(line, " %15s %4095s", e.day, e.path) != 2)
+		{
+			continue;
+		}
+		if (r->count == r->size)
+		{
+			size_t newsize = r->size ? r->size * 2 : 32;
+			struct entry *newpool = realloc(r->pool, newsize * sizeof(newpool[0]));
+			if (!newpool)
+			{
+				free(line);
+				return -1;
+			}
+			r->pool = newpool;
+			r->size = newsize;
+		}
+		r->pool[r->count++] = e;
+	}
+	free(line);
+	return 0;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t ref_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Cycle counter of this thread and of the threads it starts from now on,
+ * -1 if perf events are not available. The cycles of a started thread
+ * are added when it exits, as pools are joined before a part returns.
+ */
+static int open_cycles(void)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.inherit = 1;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t read_cycles(int fd)
+{
+	uint64_t count;
+	if (fd >= 0 && read(fd, &count, sizeof(count)) == sizeof(count))
+	{
+		return count;
+	}
+	return ref_cycles();
+}
+
+/*
+ * Reset the peak resident set, where the kernel allows it. Elsewhere the
+ * peak only grows, over the phases and runs of an entry, but entries do
+ * not see each other's peak as each one runs in a process of its own.
+ */
+static void reset_maxrss(void)
+{
+	int fd = open("/proc/self/clear_refs", O_WRONLY);
+	if (fd >= 0)
+	{
+		if (write(fd, "5", 1) != 1)
+		{
+			/* keep the peak of the whole process */
+		}
+		close(fd);
+	}
+}
+
+/* peak resident set in KiB since the last reset */
+static long read_maxrss(void)
+{
+	long kb = -1;
+	FILE *f = fopen("/proc/self/status", "r");
+	if (f)
+	{
+		char line[256];
+		while (fgets(line, sizeof(line), f))
+		{
+			if (sscanf(line, "VmHWM: %ld kB", &kb) == 1)
+			{
+				break;
+			}
+		}
+		fclose(f);
+	}
+	if (kb < 0)
+	{
+		struct rusage ru;
+		getrusage(RUSAGE_SELF, &ru);
+		kb = ru.ru_maxrss;
+	}
+	return kb;
+}
+
+enum { PARSE, PART1, PART2, PHASES };
+
+static const char *phase_names[PHASES] = { "parse", "part1", "part2" };
+
+struct timer
+{
+	int fd;
+	uint64_t ns;
+	uint64_t cycles;
+};
+
+static void timer_start(struct timer *t)
+{
+	reset_maxrss();
+	t->cycles = read_cycles(t->fd);
+	t->ns = now_ns();
+}
+
+static void timer_stop(struct timer *t, struct sample *s)
+{
+	s->ns = now_ns() - t->ns;
+	s->cycles = read_cycles(t->fd) - t->cycles;
+	s->maxrss = read_maxrss();
+}
+
+/* parse the input and run both parts once, timing each phase */
+static int run(const struct solver *sv, const struct entry *e, FILE *null,
+	       struct timer *t, struct sample s[PHASES])
+{
+	FILE *input = fopen(e->path, "rb");
+	if (!input)
+	{
+		return -1;
+	}
+	timer_start(t);
+	void *data = sv->parse(input);
+	timer_stop(t, s + PARSE);
+	fclose(input);
+	if (!data)
+	{
+		return -1;
+	}
+
+	int r = 0;
+	int (*parts[])(void *, FILE *) = { sv->part1, sv->part2 };
+	for (int i = 0; r == 0 && i < 2 && parts[i]; i++)
+	{
+		timer_start(t);
+		r = parts[i](data, null);
+		timer_stop(t, s + PART1 + i);
+	}
+	sv->free(data);
+	return r;
+}
+
+static int u64_cmp(const void *d1, const void *d2)
+{
+	uint64_t a = *(const uint64_t *)d1;
+	uint64_t b = *(const uint64_t *)d2;
+	return a < b ? -1 : a > b;
+}
+
+/* nearest-rank percentile of a sorted array */
+static uint64_t percentile(const uint64_t *v, size_t count, size_t pct)
+{
+	size_t rank = (pct * count + 99) / 100;
+	return v[rank ? rank - 1 : 0];
+}
+
+static void report(const struct entry *e, int phase, uint64_t *ns,
+		   uint64_t *cycles, long maxrss, size_t runs, FILE *out)
+{
+	qsort(ns, runs, sizeof(ns[0]), u64_cmp);
+	qsort(cycles, runs, sizeof(cycles[0]), u64_cmp);
+	fprintf(out, "%s,%s,%s,%zu,%llu,%llu,%llu,%llu,%ld\n",
+		e->day, e->path, phase_names[phase], runs,
+		(unsigned long long)ns[0],
+		(unsigned long long)percentile(ns, runs, 50),
+		(unsigned long long)percentile(ns, runs, 99),
+		(unsigned long long)percentile(cycles, runs, 50),
+		maxrss);
+}
+
+static int bench(const struct entry *e, size_t runs, FILE *null, FILE *out)
+{
+	const struct solver *sv = day_find(e->day);
+	if (!sv)
+	{
+		fprintf(stderr, "Unknown day %s\n", e->day);
+		return -1;
+	}
+
+	uint64_t *ns = malloc(PHASES * runs * sizeof(ns[0]));
+	uint64_t *cycles = malloc(PHASES * runs * sizeof(cycles[0]));
+	if (!ns || !cycles)
+	{
+		free(cycles);
+		free(ns);
+		return -1;
+	}
+
+	/* one warm-up run to fault in the code and the input */
+	struct timer t = { .fd = open_cycles() };
+	struct sample s[PHASES] = {{0}};
+	long maxrss[PHASES] = {0};
+	int r = run(sv, e, null, &t, s);
+	for (size_t i = 0; r == 0 && i < runs; i++)
+	{
+		r = run(sv, e, null, &t, s);
+		for (int p = 0; p < PHASES; p++)
+		{
+			ns[p * runs + i] = s[p].ns;
+			cycles[p * runs + i] = s[p].cycles;
+			if (maxrss[p] < s[p].maxrss)
+			{
+				maxrss[p] = s[p].maxrss;
+			}
+		}
+	}
+
+	if (r == 0)
+	{
+		int phases = sv->part2 ? PHASES : PART2;
+		for (int p = 0; p < phases; p++)
+		{
+			report(e, p, ns + p * runs, cycles + p * runs, maxrss[p], runs, out);
+		}
+	}
+	else
+	{
+		fprintf(stderr, "%s %s failed\n", e->day, e->path);
+	}
+	if (t.fd >= 0)
+	{
+		close(t.fd);
+	}
+	free(cycles);
+	free(ns);
+	return r;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t runs = 10;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			runs = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			optind = argc;
+			break;
+		}
+	}
+	if (optind >= argc || runs == 0)
+	{
+		fprintf(stderr, "Usage: %s [-n runs] registry [day...]\n", argv[0]);
+		return 1;
+	}
+
+	FILE *input = fopen(argv[optind], "rb");
+	if (!input)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[optind]);
+		return 1;
+	}
+
+	struct registry r;
+	int err = registry_load(&r, input);
+	fclose(input);
+	if (err < 0)
+	{
+		fprintf(stderr, "Cannot parse the registry\n");
+		return 1;
+	}
+
+	/* the answers are computed but not printed */
+	FILE *null = fopen("/dev/null", "w");
+	if (!null)
+	{
+		fprintf(stderr, "Cannot open /dev/null\n");
+		free(r.pool);
+		return 1;
+	}
+
+	int failed = 0;
+	printf("day,input,phase,runs,min_ns,median_ns,p99_ns,median_cycles,maxrss_kb\n");
+	for (const struct entry *e = r.pool; e < r.pool + r.count; e++)
+	{
+		/* optionally restrict to the days on the command line */
+		int selected = optind + 1 == argc;
+		for (int i = optind + 1; !selected && i < argc; i++)
+		{
+			selected = strcmp(argv[i], e->day) == 0;
+		}
+		if (!selected)
+		{
+			continue;
+		}
+
+		/* a child per entry, so that the peak resident set is its own */
+		fflush(stdout);
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			int r = bench(e, runs, null, stdout);
+			fflush(stdout);
+			_exit(r < 0);
+		}
+		int status;
+		if (pid < 0 || waitpid(pid, &status, 0) < 0 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status))
+		{
+			failed = 1;
+		}
+	}
+	fclose(null);
+	free(r.pool);
+	return failed;
+}
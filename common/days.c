@@ -0,0 +1,45 @@
+#include <string.h>
+
+#include "days.h"
+
+const struct solver *const days[] = {
+	&day1_solver,
+	&day2_solver,
+	&day3_solver,
+	&day4_solver,
+	&day5_solver,
+	&day6_solver,
+	&day7_solver,
+	&day8_solver,
+	&day9_solver,
+	&day10_solver,
+	&day11_solver,
+	&day12_solver,
+	&day13_solver,
+	&day14_solver,
+	&day15_solver,
+	&day16_solver,
+	&day17_solver,
+	&day18_solver,
+	&day19_solver,
+	&day20_solver,
+	&day21_solver,
+	&day22_solver,
+	&day23_solver,
+	&day24_solver,
+	&day25_solver,
+};
+
+const size_t day_count = sizeof(days) / sizeof(days[0]);
+
+const struct solver *day_find(const char *name)
+{
+	for (size_t i = 0; i < day_count; i++)
+	{
+		if (strcmp(days[i]->name, name) == 0)
+		{
+			return days[i];
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,41 @@
+#ifndef DAYS_H
+#define DAYS_H
+
+#include <stddef.h>
+
+#include "solver.h"
+
+extern const struct solver day1_solver;
+extern const struct solver day2_solver;
+extern const struct solver day3_solver;
+extern const struct solver day4_solver;
+extern const struct solver day5_solver;
+extern const struct solver day6_solver;
+extern const struct solver day7_solver;
+extern const struct solver day8_solver;
+extern const struct solver day9_solver;
+extern const struct solver day10_solver;
+extern const struct solver day11_solver;
+extern const struct solver day12_solver;
+extern const struct solver day13_solver;
+extern const struct solver day14_solver;
+extern const struct solver day15_solver;
+extern const struct solver day16_solver;
+extern const struct solver day17_solver;
+extern const struct solver day18_solver;
+extern const struct solver day19_solver;
+extern const struct solver day20_solver;
+extern const struct solver day21_solver;
+extern const struct solver day22_solver;
+extern const struct solver day23_solver;
+extern const struct solver day24_solver;
+extern const struct solver day25_solver;
+
+/* all the days in order */
+extern const struct solver *const days[];
+extern const size_t day_count;
+
+/* find a day by name, NULL if missing */
+const struct solver *day_find(const char *name);
+
+#endif
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "input.h"
+
+static int input_read(struct input *in, FILE *file)
+{
+	char *buf = NULL;
+	size_t size = 0, count = 0;
+	for (;;)
+	{
+		if (count == size)
+		{
+			size_t nsize = size ? size * 2 : 65536;
+			char *n = realloc(buf, nsize);
+			if (!n)
+			{
+				free(buf);
+				return -1;
+			}
+			buf = n;
+			size = nsize;
+		}
+		size_t r = fread(buf + count, 1, size - count, file);
+		if (r == 0)
+		{
+			break;
+		}
+		count += r;
+	}
+	if (ferror(file))
+	{
+		free(buf);
+		return -1;
+	}
+	in->data = in->pos = buf;
+	in->end = buf + count;
+	in->map = buf;
+	in->mapsize = 0;
+	return 0;
+}
+
+int input_map(struct input *in, FILE *file)
+{
+	struct stat st;
+	int fd = fileno(file);
+	if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+	{
+		return input_read(in, file);
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+	{
+		return input_read(in, file);
+	}
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	in->data = in->pos = map;
+	in->end = in->data + st.st_size;
+	in->map = map;
+	in->mapsize = st.st_size;
+	return 0;
+}
+
+void input_unmap(struct input *in)
+{
+	if (in->mapsize)
+	{
+		munmap(in->map, in->mapsize);
+	}
+	else
+	{
+		free(in->map);
+	}
+	memset(in, 0, sizeof(*in));
+}
+
+static int is_digit(char c)
+{
+	return (unsigned char)(c - '0') < 10;
+}
+
+/* find the first byte that can start a number */
+static const char *skip_separators(const char *p, const char *end)
+{
+#ifdef __SSE2__
+	/* signed compares, so bias the bytes to make them unsigned */
+	const __m128i bias = _mm_set1_epi8(-128);
+	const __m128i low = _mm_set1_epi8('0' - 1 - 128);
+	const __m128i high = _mm_set1_epi8('9' + 1 - 128);
+	const __m128i minus = _mm_set1_epi8('-');
+	const __m128i plus = _mm_set1_epi8('+');
+	while (end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+		__m128i b = _mm_add_epi8(v, bias);
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(b, low),
+					      _mm_cmplt_epi8(b, high));
+		__m128i sign = _mm_or_si128(_mm_cmpeq_epi8(v, minus), _mm_cmpeq_epi8(v, plus));
+		int mask = _mm_movemask_epi8(_mm_or_si128(digit, sign));
+		if (mask)
+		{
+			return p + __builtin_ctz(mask);
+		}
+		p += 16;
+	}
+#endif
+	while (p < end && !is_digit(*p) && *p != '-' && *p != '+')
+	{
+		p++;
+	}
+	return p;
+}
+
+int input_next_i64(struct input *in, int64_t *value)
+{
+	const char *p = in->pos;
+	const char *end = in->end;
+	for (;;)
+	{
+		p = skip_separators(p, end);
+		if (p == end)
+		{
+			in->pos = p;
+			return 0;
+		}
+		else if (is_digit(*p))
+		{
+			break;
+		}
+		else if (p + 1 < end && is_digit(p[1]))
+		{
+			/* a sign immediately followed by a digit */
+			break;
+		}
+		p++;
+	}
+
+	int neg = *p == '-';
+	p += !is_digit(*p);
+
+	uint64_t v = 0;
+	while (p < end && is_digit(*p))
+	{
+		v = v * 10 + (*p++ - '0');
+	}
+	in->pos = p;
+	*value = neg ? -(int64_t)v : (int64_t)v;
+	return 1;
+}
+
+int input_next_int(struct input *in, int *value)
+{
+	int64_t v;
+	if (!input_next_i64(in, &v))
+	{
+		return 0;
+	}
+	*value = v;
+	return 1;
+}
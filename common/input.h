@@ -0,0 +1,40 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Memory mapped view of an input file.
+ *
+ * The numbers are parsed in place from the mapping without going
+ * through stdio. Streams that cannot be mapped, like pipes, are read
+ * into a heap buffer instead.
+ */
+struct input
+{
+	const char *data;	/* start of the contents */
+	const char *end;	/* one past the last byte */
+	const char *pos;	/* scanning position */
+
+	void *map;		/* mapping or heap buffer to release */
+	size_t mapsize;		/* size of the mapping, 0 for the heap */
+};
+
+/* map the whole stream, returns 0 on success and -1 on error */
+int input_map(struct input *in, FILE *file);
+
+/* release the contents */
+void input_unmap(struct input *in);
+
+/*
+ * Skip to the next signed decimal integer and parse it. Everything
+ * that is not a digit or a sign immediately followed by a digit is
+ * treated as a separator. Returns 1 if a number was stored, 0 at the
+ * end of the input.
+ */
+int input_next_i64(struct input *in, int64_t *value);
+int input_next_int(struct input *in, int *value);
+
+#endif
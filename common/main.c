@@ -0,0 +1,9 @@
+#include "solver.h"
+
+/* each day links this with -DSOLVER=dayN_solver */
+extern const struct solver SOLVER;
+
+int main(int argc, char *argv[])
+{
+	return solver_main(&SOLVER, argc, argv);
+}
@@ -0,0 +1,348 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+struct task
+{
+	void (*fn)(void *);
+	void *arg;
+};
+
+/* ring of tasks, the owner works at the tail and thieves at the head */
+struct deque
+{
+	pthread_mutex_t lock;
+	struct task *slot;
+	size_t mask;
+	size_t head;
+	size_t tail;
+};
+
+struct worker
+{
+	struct pool *pool;
+	size_t index;
+	pthread_t thread;
+	struct deque tasks;
+};
+
+struct pool
+{
+	pthread_mutex_t lock;
+	pthread_cond_t ready;	/* a task was queued or the pool stops */
+	pthread_cond_t idle;	/* the last pending task completed */
+
+	size_t queued;		/* tasks sitting in the deques */
+	size_t pending;		/* queued or running tasks */
+	size_t next;		/* deque of the next outside submission */
+	int stop;
+
+	struct worker *workers;
+	size_t count;
+	size_t started;		/* workers with a thread */
+};
+
+static __thread struct worker *self;
+
+static int deque_init(struct deque *d)
+{
+	d->mask = 15;
+	d->head = d->tail = 0;
+	d->slot = malloc((d->mask + 1) * sizeof(d->slot[0]));
+	if (!d->slot)
+	{
+		return -1;
+	}
+	pthread_mutex_init(&d->lock, NULL);
+	return 0;
+}
+
+static void deque_destroy(struct deque *d)
+{
+	pthread_mutex_destroy(&d->lock);
+	free(d->slot);
+}
+
+static int deque_push(struct deque *d, struct task t)
+{
+	pthread_mutex_lock(&d->lock);
+	if (d->tail - d->head > d->mask)
+	{
+		size_t size = d->mask + 1;
+		struct task *slot = malloc(2 * size * sizeof(slot[0]));
+		if (!slot)
+		{
+			pthread_mutex_unlock(&d->lock);
+			return -1;
+		}
+		for (size_t i = 0; i < size; i++)
+		{
+			slot[i] = d->slot[(d->head + i) & d->mask];
+		}
+		free(d->slot);
+		d->slot = slot;
+		d->mask = 2 * size - 1;
+		d->head = 0;
+		d->tail = size;
+	}
+	d->slot[d->tail++ & d->mask] = t;
+	pthread_mutex_unlock(&d->lock);
+	return 0;
+}
+
+/* newest task of the owner */
+static int deque_pop(struct deque *d, struct task *t)
+{
+	int found = 0;
+	pthread_mutex_lock(&d->lock);
+	if (d->tail != d->head)
+	{
+		*t = d->slot[--d->tail & d->mask];
+		found = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return found;
+}
+
+/* oldest task, for a thief */
+static int deque_steal(struct deque *d, struct task *t)
+{
+	int found = 0;
+	pthread_mutex_lock(&d->lock);
+	if (d->tail != d->head)
+	{
+		*t = d->slot[d->head++ & d->mask];
+		found = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return found;
+}
+
+/* a task for worker w, or for a thread outside of the pool if w is NULL */
+static int pool_take(struct pool *p, struct worker *w, struct task *t)
+{
+	if (w && deque_pop(&w->tasks, t))
+	{
+		return 1;
+	}
+	size_t start = w ? w->index : 0;
+	for (size_t i = w ? 1 : 0; i < p->count; i++)
+	{
+		if (deque_steal(&p->workers[(start + i) % p->count].tasks, t))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* run a task taken from a deque */
+static void pool_exec(struct pool *p, struct task t)
+{
+	pthread_mutex_lock(&p->lock);
+	p->queued--;
+	pthread_mutex_unlock(&p->lock);
+
+	t.fn(t.arg);
+
+	pthread_mutex_lock(&p->lock);
+	if (--p->pending == 0)
+	{
+		pthread_cond_broadcast(&p->idle);
+	}
+	pthread_mutex_unlock(&p->lock);
+}
+
+static void *pool_run(void *arg)
+{
+	struct worker *w = arg;
+	struct pool *p = w->pool;
+	self = w;
+	pthread_mutex_lock(&p->lock);
+	for (;;)
+	{
+		while (!p->queued && !p->stop)
+		{
+			pthread_cond_wait(&p->ready, &p->lock);
+		}
+		if (!p->queued)
+		{
+			break;
+		}
+		pthread_mutex_unlock(&p->lock);
+
+		/* the task may still be on its way or taken by another worker */
+		struct task t;
+		if (pool_take(p, w, &t))
+		{
+			pool_exec(p, t);
+		}
+		else
+		{
+			sched_yield();
+		}
+		pthread_mutex_lock(&p->lock);
+	}
+	pthread_mutex_unlock(&p->lock);
+	return NULL;
+}
+
+struct pool *pool_new(size_t threads)
+{
+	if (threads == 0)
+	{
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = n > 0 ? n : 1;
+	}
+
+	struct pool *p = calloc(1, sizeof(*p));
+	if (!p)
+	{
+		return NULL;
+	}
+	p->workers = calloc(threads, sizeof(p->workers[0]));
+	if (!p->workers)
+	{
+		free(p);
+		return NULL;
+	}
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->ready, NULL);
+	pthread_cond_init(&p->idle, NULL);
+
+	/* the deques are all set up before any worker may steal */
+	for (; p->count < threads; p->count++)
+	{
+		struct worker *w = p->workers + p->count;
+		w->pool = p;
+		w->index = p->count;
+		if (deque_init(&w->tasks) < 0)
+		{
+			break;
+		}
+	}
+	/* the deques of workers without a thread still get robbed */
+	for (; p->started < p->count; p->started++)
+	{
+		struct worker *w = p->workers + p->started;
+		if (pthread_create(&w->thread, NULL, pool_run, w))
+		{
+			break;
+		}
+	}
+	if (p->started == 0)
+	{
+		pool_free(p);
+		return NULL;
+	}
+	return p;
+}
+
+size_t pool_size(const struct pool *p)
+{
+	return p->count;
+}
+
+int pool_worker(const struct pool *p)
+{
+	return self && self->pool == p ? (int)self->index : -1;
+}
+
+struct pool *pool_current(void)
+{
+	return self ? self->pool : NULL;
+}
+
+int pool_submit(struct pool *p, void (*fn)(void *), void *arg)
+{
+	struct task t = { fn, arg };
+	struct worker *w = self && self->pool == p ? self : NULL;
+	if (!w)
+	{
+		pthread_mutex_lock(&p->lock);
+		w = p->workers + p->next++ % p->count;
+		pthread_mutex_unlock(&p->lock);
+	}
+
+	/*
+	 * Count the task before it can be taken, so that the counters
+	 * never drop below the tasks actually queued or running.
+	 */
+	pthread_mutex_lock(&p->lock);
+	p->queued++;
+	p->pending++;
+	pthread_mutex_unlock(&p->lock);
+
+	int r = deque_push(&w->tasks, t);
+
+	pthread_mutex_lock(&p->lock);
+	if (r < 0)
+	{
+		p->queued--;
+		if (--p->pending == 0)
+		{
+			pthread_cond_broadcast(&p->idle);
+		}
+	}
+	else
+	{
+		pthread_cond_signal(&p->ready);
+	}
+	pthread_mutex_unlock(&p->lock);
+	return r;
+}
+
+void pool_wait(struct pool *p)
+{
+	pthread_mutex_lock(&p->lock);
+	while (p->pending)
+	{
+		pthread_cond_wait(&p->idle, &p->lock);
+	}
+	pthread_mutex_unlock(&p->lock);
+}
+
+void pool_help(struct pool *p, const size_t *left)
+{
+	struct worker *w = self && self->pool == p ? self : NULL;
+	while (__atomic_load_n(left, __ATOMIC_ACQUIRE))
+	{
+		struct task t;
+		if (pool_take(p, w, &t))
+		{
+			pool_exec(p, t);
+		}
+		else
+		{
+			sched_yield();
+		}
+	}
+}
+
+void pool_free(struct pool *p)
+{
+	if (p)
+	{
+		pool_wait(p);
+		pthread_mutex_lock(&p->lock);
+		p->stop = 1;
+		pthread_cond_broadcast(&p->ready);
+		pthread_mutex_unlock(&p->lock);
+		for (size_t i = 0; i < p->started; i++)
+		{
+			pthread_join(p->workers[i].thread, NULL);
+		}
+		for (size_t i = 0; i < p->count; i++)
+		{
+			deque_destroy(&p->workers[i].tasks);
+		}
+		pthread_cond_destroy(&p->idle);
+		pthread_cond_destroy(&p->ready);
+		pthread_mutex_destroy(&p->lock);
+		free(p->workers);
+		free(p);
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/*
+ * Fixed set of worker threads with one task deque each. A worker runs
+ * the newest task of its own deque first and, once it is empty, steals
+ * the oldest task of another worker.
+ */
+struct pool;
+
+/* start the workers, 0 threads means one per online cpu */
+struct pool *pool_new(size_t threads);
+
+/* number of workers */
+size_t pool_size(const struct pool *p);
+
+/*
+ * Queue fn(arg), returns 0 on success and -1 on error. From a worker
+ * the task goes to the worker's own deque, otherwise the deques are
+ * filled in turn.
+ */
+int pool_submit(struct pool *p, void (*fn)(void *), void *arg);
+
+/* index of the calling worker, -1 outside of the pool */
+int pool_worker(const struct pool *p);
+
+/* pool of the calling worker, NULL outside of any pool */
+struct pool *pool_current(void);
+
+/* wait until every queued task has completed, not from a worker */
+void pool_wait(struct pool *p);
+
+/*
+ * Run tasks of the pool until *left drops to 0, for a caller waiting on
+ * some of the tasks it queued, which decrement *left atomically when
+ * they are done. Unlike pool_wait() this also works from a worker, so
+ * a task can split its work on the pool it runs on. Tasks run while
+ * helping may be any tasks of the pool.
+ */
+void pool_help(struct pool *p, const size_t *left);
+
+/* wait for the tasks and stop the workers */
+void pool_free(struct pool *p);
+
+#endif
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "prof.h"
+
+static struct prof *probes;
+
+/* ticks and time of the first registration, to convert ticks to time */
+static uint64_t base_ticks;
+static uint64_t base_ns;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t prof_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return now_ns();
+#endif
+}
+
+static int prof_cmp(const void *a, const void *b)
+{
+	const struct prof *pa = *(const struct prof *const *)a;
+	const struct prof *pb = *(const struct prof *const *)b;
+	int r = strcmp(pa->file, pb->file);
+	return r ? r : strcmp(pa->name, pb->name);
+}
+
+static void prof_report(void)
+{
+	size_t count = 0;
+	for (struct prof *p = probes; p; p = p->next)
+	{
+		count++;
+	}
+	struct prof **sorted = malloc(count * sizeof(sorted[0]));
+	if (!sorted)
+	{
+		return;
+	}
+	count = 0;
+	for (struct prof *p = probes; p; p = p->next)
+	{
+		sorted[count++] = p;
+	}
+	qsort(sorted, count, sizeof(sorted[0]), prof_cmp);
+
+	uint64_t ns = now_ns() - base_ns;
+	uint64_t ticks = prof_ticks() - base_ticks;
+	double ns_per_tick = ticks ? (double)ns / ticks : 1;
+
+	const char *file = "";
+	for (size_t i = 0; i < count; i++)
+	{
+		const struct prof *p = sorted[i];
+		if (strcmp(file, p->file))
+		{
+			file = p->file;
+			const char *slash = strrchr(file, '/');
+			const char *name = slash ? slash + 1 : file;
+			fprintf(stderr, "%.*s\n", (int)strcspn(name, "."), name);
+			fprintf(stderr, "  %-20s %12s %14s %10s %12s %14s %12s\n",
+				"probe", "calls", "total ns", "ns/call",
+				"ticks/call", "items", "items/s");
+		}
+
+		double total = p->ticks * ns_per_tick;
+		double calls = p->calls ? p->calls : 1;
+		fprintf(stderr, "  %-20s %12llu %14.0f %10.1f %12.1f %14llu %12.4g\n",
+			p->name, (unsigned long long)p->calls, total,
+			total / calls, p->ticks / calls,
+			(unsigned long long)p->items,
+			total > 0 ? p->items * 1e9 / total : 0);
+
+		int hist = 0;
+		for (int b = 0; b < PROF_BUCKETS; b++)
+		{
+			if (p->hist[b])
+			{
+				if (!hist++)
+				{
+					fprintf(stderr, "  %-20s", "");
+				}
+				fprintf(stderr, " %llu:%llu",
+					b ? 1ULL << (b - 1) : 0ULL,
+					(unsigned long long)p->hist[b]);
+			}
+		}
+		if (hist)
+		{
+			fputc('\n', stderr);
+		}
+	}
+	free(sorted);
+}
+
+void prof_register(struct prof *p)
+{
+	int expected = 0;
+	if (!__atomic_compare_exchange_n(&p->registered, &expected, 1, 0,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		return;
+	}
+
+	struct prof *head = __atomic_load_n(&probes, __ATOMIC_ACQUIRE);
+	if (!head)
+	{
+		static int once;
+		if (!__atomic_exchange_n(&once, 1, __ATOMIC_ACQ_REL))
+		{
+			base_ns = now_ns();
+			base_ticks = prof_ticks();
+			if (getenv("AOC_PROF"))
+			{
+				atexit(prof_report);
+			}
+		}
+	}
+	do
+	{
+		p->next = head;
+	}
+	while (!__atomic_compare_exchange_n(&probes, &head, p, 0,
+					    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+}
+
+void prof_timer_stop(struct prof_timer *t)
+{
+	uint64_t ticks = prof_ticks() - t->start;
+	__atomic_fetch_add(&t->p->calls, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&t->p->ticks, ticks, __ATOMIC_RELAXED);
+}
+
+void prof_hist(struct prof *p, uint64_t value)
+{
+	int b = value ? 64 - __builtin_clzll(value) : 0;
+	if (b >= PROF_BUCKETS)
+	{
+		b = PROF_BUCKETS - 1;
+	}
+	__atomic_fetch_add(&p->calls, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&p->items, value, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&p->hist[b], 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,91 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+
+/*
+ * Optional instrumentation of the hot paths.
+ *
+ * Built with -DAOC_PROF (make PROF=1) the macros below keep, for each
+ * probe, the number of calls, the elapsed cycles, a number of items
+ * and a power of two histogram. The report is written to stderr at
+ * exit when AOC_PROF is set in the environment. Without -DAOC_PROF
+ * the macros expand to nothing.
+ *
+ *	PROF_SCOPE(t, "name");	times the rest of the enclosing block
+ *	PROF_ITEMS(t, n);	adds n items to the probe of the scope
+ *	PROF_COUNT("name", n);	counts one event of n items
+ *	PROF_HIST("name", v);	adds v to the histogram of the probe
+ *
+ * Probes are grouped in the report by the file they are in.
+ */
+
+#define PROF_BUCKETS 33
+
+struct prof
+{
+	const char *file;
+	const char *name;
+	uint64_t calls;
+	uint64_t ticks;
+	uint64_t items;
+	uint64_t hist[PROF_BUCKETS];	/* values in [2^(i-1), 2^i) */
+	struct prof *next;
+	int registered;
+};
+
+struct prof_timer
+{
+	struct prof *p;
+	uint64_t start;
+};
+
+/* clock of the probes, cycles where available */
+uint64_t prof_ticks(void);
+
+/* add the probe to the report on first use */
+void prof_register(struct prof *p);
+
+void prof_timer_stop(struct prof_timer *t);
+void prof_hist(struct prof *p, uint64_t value);
+
+#ifdef AOC_PROF
+
+#define PROF_CAT_(a, b) a##b
+#define PROF_CAT(a, b) PROF_CAT_(a, b)
+#define PROF_PROBE(name) \
+	static struct prof PROF_CAT(prof_, __LINE__) = { __FILE__, name }; \
+	if (!__atomic_load_n(&PROF_CAT(prof_, __LINE__).registered, __ATOMIC_ACQUIRE)) \
+		prof_register(&PROF_CAT(prof_, __LINE__))
+
+#define PROF_SCOPE(t, name) \
+	PROF_PROBE(name); \
+	struct prof_timer t __attribute__((cleanup(prof_timer_stop))) = \
+		{ &PROF_CAT(prof_, __LINE__), prof_ticks() }
+
+#define PROF_ITEMS(t, n) \
+	__atomic_fetch_add(&(t).p->items, (n), __ATOMIC_RELAXED)
+
+#define PROF_COUNT(name, n) \
+	do { \
+		PROF_PROBE(name); \
+		__atomic_fetch_add(&PROF_CAT(prof_, __LINE__).calls, 1, __ATOMIC_RELAXED); \
+		__atomic_fetch_add(&PROF_CAT(prof_, __LINE__).items, (n), __ATOMIC_RELAXED); \
+	} while (0)
+
+#define PROF_HIST(name, v) \
+	do { \
+		PROF_PROBE(name); \
+		prof_hist(&PROF_CAT(prof_, __LINE__), (v)); \
+	} while (0)
+
+#else
+
+#define PROF_SCOPE(t, name)
+#define PROF_ITEMS(t, n) ((void)sizeof(n))
+#define PROF_COUNT(name, n) ((void)sizeof(n))
+#define PROF_HIST(name, v) ((void)sizeof(v))
+
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+#include <string.h>
+#include <unistd.h>
+
+#include "solver.h"
+
+int solver_part(const struct solver *s, int n, void *data, FILE *output)
+{
+	fprintf(output, "Part%d: ", n);
+	int r = (n == 1 ? s->part1 : s->part2)(data, output);
+	fputc('\n', output);
+	return r;
+}
+
+int solver_parts(const struct solver *s, void *data, FILE *output)
+{
+	int r = solver_part(s, 1, data, output);
+	if (r == 0 && s->part2)
+	{
+		r = solver_part(s, 2, data, output);
+	}
+	return r;
+}
+
+int solver_run(const struct solver *s, FILE *input, FILE *output)
+{
+	void *data = s->parse(input);
+	if (!data)
+	{
+		return -1;
+	}
+	int r = solver_parts(s, data, output);
+	s->free(data);
+	return r;
+}
+
+int solver_main(const struct solver *s, int argc, char *argv[])
+{
+	int opt;
+	while (s->options && (opt = getopt(argc, argv, s->options)) != -1)
+	{
+		if (opt == '?' || s->option(opt, optarg) < 0)
+		{
+			optind = argc;
+			break;
+		}
+	}
+	if (optind >= argc)
+	{
+		fprintf(stderr, "Usage: %s %s%sfilename\n", argv[0],
+			s->usage ? s->usage : "", s->usage ? " " : "");
+		return 1;
+	}
+
+	FILE *input = fopen(argv[optind], "rb");
+	if (!input)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[optind]);
+		return 1;
+	}
+
+	void *data = s->parse(input);
+	fclose(input);
+	if (!data)
+	{
+		fprintf(stderr, "Cannot parse the data\n");
+		return 1;
+	}
+
+	int r = solver_parts(s, data, stdout);
+	s->free(data);
+	return r < 0;
+}
@@ -0,0 +1,45 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdio.h>
+
+/* the parts modify the data, run part1 then part2 and never both at once */
+#define SOLVER_SERIAL 1
+
+/*
+ * Entry points of a day.
+ *
+ * parse() builds the data from the input and returns NULL on error.
+ * The parts print their answer, without the "PartN: " prefix and the
+ * newline, and return 0 on success or -1 on error. Unless the solver
+ * is marked SOLVER_SERIAL the parts must leave the data untouched, so
+ * that they can run in any order, more than once and concurrently.
+ * Serial parts still have to give the same answer when run again.
+ */
+struct solver
+{
+	const char *name;
+	const char *options;	/* getopt() options, NULL if none */
+	const char *usage;	/* usage of the options */
+	int (*option)(int opt, const char *arg);
+
+	void *(*parse)(FILE *input);
+	void (*free)(void *data);
+	int (*part1)(void *data, FILE *output);
+	int (*part2)(void *data, FILE *output);	/* NULL if missing */
+	unsigned flags;
+};
+
+/* print part n, 1 or 2, for the data, returns 0 on success */
+int solver_part(const struct solver *s, int n, void *data, FILE *output);
+
+/* print both parts for the data, returns 0 on success */
+int solver_parts(const struct solver *s, void *data, FILE *output);
+
+/* parse the input and print both parts, returns 0 on success */
+int solver_run(const struct solver *s, FILE *input, FILE *output);
+
+/* main() of a single day binary */
+int solver_main(const struct solver *s, int argc, char *argv[]);
+
+#endif
@@ -1,32 +1,127 @@
 #include <assert.h>
-#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-struct hash
+#include "input.h"
+#include "solver.h"
+
+/*
+ * Open addressing set of ints with Robin Hood linear probing.
+ *
+ * Each slot stores the value and its probe sequence length plus one,
+ * so that a zero psl marks an empty slot and every int is a valid
+ * key. When the load factor exceeds 3/4 the set allocates a table of
+ * twice the size and migrates the old slots a few at a time on each
+ * insertion, so no single hash_add() pays for the whole rehash.
+ */
+struct entry
+{
+	int value;
+	unsigned psl;
+};
+
+struct table
 {
-	int *table;
-	size_t capacity;
+	struct entry *slot;
+	size_t mask;
 	size_t count;
 };
 
-static struct hash *hash_new(size_t capacity)
+struct hash
 {
-	struct hash *h = calloc(1, sizeof(h[0]));
-	if (h)
+	struct table cur;	/* table receiving the insertions */
+	struct table old;	/* table being migrated, if any */
+	size_t migrated;	/* slots of old already migrated */
+};
+
+/* number of old slots migrated for each insertion */
+#define HASH_MIGRATE_STEP 4
+
+static size_t hash_fn(int value)
+{
+	/* murmur3 finalizer */
+	uint32_t h = (uint32_t)value;
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+	return h;
+}
+
+static int table_init(struct table *t, size_t capacity)
+{
+	t->slot = calloc(capacity, sizeof(t->slot[0]));
+	if (!t->slot)
+	{
+		return -1;
+	}
+	t->mask = capacity - 1;
+	t->count = 0;
+	return 0;
+}
+
+static void table_insert(struct table *t, int value)
+{
+	struct entry e = { value, 1 };
+	size_t pos = hash_fn(value) & t->mask;
+	for (;;)
 	{
-		h->table = malloc(capacity * sizeof(h->table[0]));
-		if (!h->table)
+		struct entry *s = t->slot + pos;
+		if (s->psl == 0)
 		{
-			free(h);
-			return NULL;
+			*s = e;
+			t->count++;
+			return;
 		}
-		h->capacity = capacity;
-		for (size_t i = 0; i < capacity; i++)
+		else if (s->psl < e.psl)
 		{
-			h->table[i] = INT_MAX;
+			/* rob the rich: the resident is closer to home */
+			struct entry tmp = *s;
+			*s = e;
+			e = tmp;
+		}
+		e.psl++;
+		pos = (pos + 1) & t->mask;
+	}
+}
+
+static int table_find(const struct table *t, int value)
+{
+	unsigned psl = 1;
+	size_t pos = hash_fn(value) & t->mask;
+	for (;;)
+	{
+		const struct entry *s = t->slot + pos;
+		if (s->psl < psl)
+		{
+			/* either empty or we would have displaced it */
+			return 0;
+		}
+		else if (s->value == value)
+		{
+			return 1;
 		}
+		psl++;
+		pos = (pos + 1) & t->mask;
+	}
+}
+
+static struct hash *hash_new(size_t capacity)
+{
+	size_t size = 16;
+	while (size < capacity)
+	{
+		size *= 2;
+	}
+
+	struct hash *h = calloc(1, sizeof(h[0]));
+	if (h && table_init(&h->cur, size) < 0)
+	{
+		free(h);
+		return NULL;
 	}
 	return h;
 }
@@ -35,50 +130,67 @@ static void hash_free(struct hash *h)
 {
 	if (h)
 	{
-		free(h->table);
+		free(h->old.slot);
+		free(h->cur.slot);
 		free(h);
 	}
 }
 
-static int hash_add(struct hash *h, int value)
+static void hash_migrate(struct hash *h)
 {
-	if (h->count * 100 / h->capacity > 75)
+	size_t end = h->migrated + HASH_MIGRATE_STEP;
+	if (end > h->old.mask + 1)
 	{
-		/* TODO: rehash */
-		abort();
+		end = h->old.mask + 1;
 	}
-	/* TODO: use custom hashfn */
-	size_t pos = (unsigned)value % h->capacity;
-	for (size_t i = 1; i < h->capacity; i++)
+	/* the old table stays untouched until it is released, so the
+	 * lookups can still probe it while the migration is going on */
+	for (; h->migrated < end; h->migrated++)
 	{
-		if (h->table[pos] == INT_MAX)
+		const struct entry *s = h->old.slot + h->migrated;
+		if (s->psl)
 		{
-			break;
+			table_insert(&h->cur, s->value);
 		}
-		pos = (pos + i*i) % h->capacity;
 	}
-	h->table[pos] = value;
-	h->count++;
-	return 1;
+	if (h->migrated == h->old.mask + 1)
+	{
+		free(h->old.slot);
+		h->old.slot = NULL;
+	}
 }
 
 static int hash_find(struct hash *h, int value)
 {
-	/* TODO: use custom hashfn */
-	size_t pos = (unsigned)value % h->capacity;
-	for (size_t i = 1; i < h->capacity; i++)
+	return table_find(&h->cur, value)
+		|| (h->old.slot && table_find(&h->old, value));
+}
+
+static int hash_add(struct hash *h, int value)
+{
+	if (hash_find(h, value))
 	{
-		if (h->table[pos] == INT_MAX)
-		{
-			return 0;
-		}
-		else if (h->table[pos] == value)
+		return 0;
+	}
+
+	if (h->old.slot)
+	{
+		hash_migrate(h);
+	}
+	else if ((h->cur.count + 1) * 4 > (h->cur.mask + 1) * 3)
+	{
+		struct table t;
+		if (table_init(&t, (h->cur.mask + 1) * 2) < 0)
 		{
-			return 1;
+			return -1;
 		}
-		pos = (pos + i*i) % h->capacity;
+		h->old = h->cur;
+		h->cur = t;
+		h->migrated = 0;
+		hash_migrate(h);
 	}
-	return 0;
+	table_insert(&h->cur, value);
+	return 1;
 }
 
 static int part1(const int *numbers, size_t count)
@@ -91,9 +203,9 @@ static int part1(const int *numbers, size_t count)
 	return freq;
 }
 
-static int part2(const int *numbers, size_t count)
+static int part2_replay(const int *numbers, size_t count)
 {
-	struct hash *freqs = hash_new(524287U);
+	struct hash *freqs = hash_new(1024);
 	if (!freqs)
 	{
 		return -1;
@@ -104,23 +216,153 @@ static int part2(const int *numbers, size_t count)
 	{
 		for (size_t i = 0; i < count; i++)
 		{
-			hash_add(freqs, freq);
-			freq += numbers[i];
-			if (hash_find(freqs, freq))
+			int r = hash_add(freqs, freq);
+			if (r <= 0)
 			{
+				/* already seen or out of memory */
 				hash_free(freqs);
-				return freq;
+				return r == 0 ? freq : -1;
 			}
+			freq += numbers[i];
 		}
 	}
 }
 
+struct prefix
+{
+	long long residue;	/* value modulo the total drift */
+	long long value;	/* frequency reached in the first pass */
+	size_t index;		/* position in the first pass */
+};
+
+static int prefix_cmp(const void *d1, const void *d2)
+{
+	const struct prefix *a = d1;
+	const struct prefix *b = d2;
+	if (a->residue != b->residue)
+		return a->residue < b->residue ? -1 : 1;
+	if (a->value != b->value)
+		return a->value < b->value ? -1 : 1;
+	return a->index < b->index ? -1 : a->index > b->index;
+}
+
+/*
+ * The frequency at position i of pass k is p[i] + k * total, so
+ * p[j] reaches an earlier p[i] after (p[i] - p[j]) / total passes
+ * only when the two are congruent modulo total. Sorting the prefix
+ * sums by residue and value leaves the candidate pairs adjacent and
+ * the first repeat is the pair with the smallest time k*count+j.
+ *
+ * Returns 1 and stores the frequency in result if a repeat exists, 0
+ * if the frequencies never repeat and -1 if out of memory.
+ */
+static int part2_cycle(const int *numbers, size_t count, int *result)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	struct prefix *p = malloc(count * sizeof(p[0]));
+	if (!p)
+	{
+		return -1;
+	}
+
+	long long freq = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		p[i].value = freq;
+		p[i].index = i;
+		freq += numbers[i];
+	}
+	long long total = freq;
+	long long mod = total < 0 ? -total : total;
+	for (size_t i = 0; i < count; i++)
+	{
+		p[i].residue = mod ? ((p[i].value % mod) + mod) % mod : 0;
+	}
+	qsort(p, count, sizeof(p[0]), prefix_cmp);
+
+	int found = 0;
+	unsigned long long passes = 0;
+	size_t pos = 0;
+	long long value = 0;
+	if (total == 0)
+	{
+		/* the second pass starts again from zero */
+		found = 1;
+		passes = 1;
+		pos = 0;
+		value = 0;
+	}
+	for (size_t i = 1; i < count; i++)
+	{
+		const struct prefix *a = p + i - 1;
+		const struct prefix *b = p + i;
+		if (a->residue != b->residue)
+		{
+			continue;
+		}
+
+		unsigned long long d;
+		size_t j;
+		long long v;
+		if (a->value == b->value)
+		{
+			/* repeated in the first pass already */
+			d = 0;
+			j = b->index;
+			v = b->value;
+		}
+		else if (total > 0)
+		{
+			/* a climbs up to b */
+			d = (b->value - a->value) / mod;
+			j = a->index;
+			v = b->value;
+		}
+		else if (total < 0)
+		{
+			/* b falls down to a */
+			d = (b->value - a->value) / mod;
+			j = b->index;
+			v = a->value;
+		}
+		else
+		{
+			continue;
+		}
+
+		if (!found || d < passes || (d == passes && j < pos))
+		{
+			found = 1;
+			passes = d;
+			pos = j;
+			value = v;
+		}
+	}
+	free(p);
+
+	if (found)
+	{
+		*result = value;
+	}
+	return found;
+}
+
 static int *load(FILE *input, size_t *count)
 {
+	struct input in;
+	if (input_map(&in, input) < 0)
+	{
+		return NULL;
+	}
+
 	size_t size = 0;
 	int *numbers = NULL, number;
 	*count = 0;
-	while (fscanf(input, " %d", &number) == 1)
+	while (input_next_int(&in, &number))
 	{
 		if (*count == size)
 		{
@@ -128,6 +370,7 @@ static int *load(FILE *input, size_t *count)
 			int *n = realloc(numbers, nsize * sizeof(*n));
 			if (!n)
 			{
+				input_unmap(&in);
 				free(numbers);
 				return NULL;
 			}
@@ -136,36 +379,90 @@ static int *load(FILE *input, size_t *count)
 		}
 		numbers[(*count)++] = number;
 	}
+	input_unmap(&in);
 	return numbers;
 }
 
-int main(int argc, char *argv[])
+struct data
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s filename\n", argv[0]);
-		return 1;
-	}
+	int *numbers;
+	size_t count;
+};
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+static int crosscheck;
+
+static int day1_option(int opt, const char *arg)
+{
+	crosscheck = 1;
+	return 0;
+}
+
+static void *day1_parse(FILE *input)
+{
+	struct data *d = malloc(sizeof(*d));
+	if (d)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		d->numbers = load(input, &d->count);
+		if (!d->numbers)
+		{
+			free(d);
+			return NULL;
+		}
 	}
+	return d;
+}
 
-	size_t count;
-	int *numbers = load(input, &count);
-	fclose(input);
+static void day1_free(void *data)
+{
+	struct data *d = data;
+	free(d->numbers);
+	free(d);
+}
 
-	if (!numbers)
+static int day1_part1(void *data, FILE *output)
+{
+	struct data *d = data;
+	fprintf(output, "%d", part1(d->numbers, d->count));
+	return 0;
+}
+
+static int day1_part2(void *data, FILE *output)
+{
+	struct data *d = data;
+	int freq;
+	int r = part2_cycle(d->numbers, d->count, &freq);
+	if (r < 0)
 	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		fprintf(stderr, "Cannot allocate the prefix sums\n");
+		return -1;
+	}
+	else if (r == 0)
+	{
+		fprintf(output, "none");
+		return 0;
 	}
+	fprintf(output, "%d", freq);
 
-	printf("Part1: %d\n", part1(numbers, count));
-	printf("Part2: %d\n", part2(numbers, count));
-	free(numbers);
+	/* the replay never ends if no frequency repeats */
+	if (crosscheck)
+	{
+		int replay = part2_replay(d->numbers, d->count);
+		if (replay != freq)
+		{
+			fprintf(stderr, "Replay mismatch: %d\n", replay);
+			return -1;
+		}
+	}
 	return 0;
 }
+
+const struct solver day1_solver = {
+	.name = "day1",
+	.options = "c",
+	.usage = "[-c]",
+	.option = day1_option,
+	.parse = day1_parse,
+	.free = day1_free,
+	.part1 = day1_part1,
+	.part2 = day1_part2,
+};
@@ -2,6 +2,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "input.h"
+#include "solver.h"
+
 struct Vec
 {
 	int x;
@@ -92,7 +95,7 @@ static int find_local_minimum(struct Light *lights, size_t count, int a, int b)
 	return time;
 }
 
-static void render(struct Light *lights, size_t count, int time)
+static void render(struct Light *lights, size_t count, int time, FILE *output)
 {
 	struct Vec *pos = malloc(count * sizeof(pos[0]));
 	if (!pos)
@@ -107,6 +110,8 @@ static void render(struct Light *lights, size_t count, int time)
 	struct Range r = find_range(lights, count, time);
 	for (int y = r.y; y < r.y + r.height; y++)
 	{
+		/* each row starts on a new line after the part 2 answer */
+		putc('\n', output);
 		for (int x = r.x; x < r.x+r.width; x++)
 		{
 			char c = ' ';
@@ -118,33 +123,31 @@ static void render(struct Light *lights, size_t count, int time)
 					break;
 				}
 			}
-			putc(c, stdout);
+			putc(c, output);
 		}
-		putc('\n', stdout);
 	}
 	free(pos);
 }
 
-int main(int argc, char *argv[])
+struct sky
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
+	struct Light *lights;
+	size_t count;
+};
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+static void *day10_parse(FILE *input)
+{
+	struct input in;
+	if (input_map(&in, input) < 0)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		return NULL;
 	}
 
 	struct Light *lights = NULL;
 	size_t count = 0, size = 0;
 	struct Vec pos, vel;
-	while (fscanf(input, " position=<%d, %d> velocity=<%d, %d>",
-			   &pos.x, &pos.y, &vel.x, &vel.y) == 4)
+	while (input_next_int(&in, &pos.x) && input_next_int(&in, &pos.y) &&
+	       input_next_int(&in, &vel.x) && input_next_int(&in, &vel.y))
 	{
 		if (count == size)
 		{
@@ -162,12 +165,50 @@ int main(int argc, char *argv[])
 		lights[count].vel = vel;
 		count++;
 	}
-	fclose(input);
+	input_unmap(&in);
 
-	int time = find_local_minimum(lights, count, 0, 100000);
-	printf("Part1: (see below)\n");
-	printf("Part2: %d\n", time);
-	render(lights, count, time);
-	free(lights);
+	struct sky *s = malloc(sizeof(*s));
+	if (!s || !count)
+	{
+		free(lights);
+		free(s);
+		return NULL;
+	}
+	s->lights = lights;
+	s->count = count;
+	return s;
+}
+
+static void day10_free(void *data)
+{
+	struct sky *s = data;
+	free(s->lights);
+	free(s);
+}
+
+/*
+ * The message of part 1 is drawn below the answer of part 2, as the
+ * lines after "Part2: " stay the same whatever reads them.
+ */
+static int day10_part1(void *data, FILE *output)
+{
+	fprintf(output, "(see below)");
 	return 0;
 }
+
+static int day10_part2(void *data, FILE *output)
+{
+	struct sky *s = data;
+	int time = find_local_minimum(s->lights, s->count, 0, 100000);
+	fprintf(output, "%d", time);
+	render(s->lights, s->count, time, output);
+	return 0;
+}
+
+const struct solver day10_solver = {
+	.name = "day10",
+	.parse = day10_parse,
+	.free = day10_free,
+	.part1 = day10_part1,
+	.part2 = day10_part2,
+};
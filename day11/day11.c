@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 static void build_grid(int grid[301][301], int serial)
 {
 	memset(grid, 0, sizeof(int)*301*301);
@@ -65,38 +67,49 @@ static int find_largest_square(int grid[301][301], int *side, int *xm, int *ym)
 	return maxp;
 }
 
-int main(int argc, char *argv[])
+struct grid
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
+	int cell[301][301];
+};
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
-	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
-	}
+static void *day11_parse(FILE *input)
+{
 	int serial;
-	int r = fscanf(input, " %d", &serial);
-	fclose(input);
-	if (r != 1)
+	if (fscanf(input, " %d", &serial) != 1)
 	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		return NULL;
 	}
 
-	int grid[301][301];
-	build_grid(grid, serial);
+	struct grid *g = malloc(sizeof(*g));
+	if (g)
+	{
+		build_grid(g->cell, serial);
+	}
+	return g;
+}
 
+static int day11_part1(void *data, FILE *output)
+{
+	struct grid *g = data;
 	int x, y;
-	find_largest_block(grid, 3, &x, &y);
-	printf("Part1: %d,%d\n", x, y);
+	find_largest_block(g->cell, 3, &x, &y);
+	fprintf(output, "%d,%d", x, y);
+	return 0;
+}
 
-	int s;
-	find_largest_square(grid, &s, &x, &y);
-	printf("Part2: %d,%d,%d\n", x, y, s);
+static int day11_part2(void *data, FILE *output)
+{
+	struct grid *g = data;
+	int s, x, y;
+	find_largest_square(g->cell, &s, &x, &y);
+	fprintf(output, "%d,%d,%d", x, y, s);
 	return 0;
 }
+
+const struct solver day11_solver = {
+	.name = "day11",
+	.parse = day11_parse,
+	.free = free,
+	.part1 = day11_part1,
+	.part2 = day11_part2,
+};
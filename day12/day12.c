@@ -5,6 +5,9 @@
 #include <string.h>
 #include <inttypes.h>
 
+#include "prof.h"
+#include "solver.h"
+
 struct Ruleset
 {
 	char (*input)[5];
@@ -100,6 +103,8 @@ static void state_free(struct State *s)
 
 static void state_step(struct State *s, const struct Ruleset *r)
 {
+	PROF_SCOPE(t, "state_step");
+	PROF_ITEMS(t, s->dsize);
 	char *new = malloc(s->dsize + 4 + 1);
 	if (new)
 	{
@@ -215,30 +220,53 @@ static void parse(FILE *input, struct State *initial, struct Ruleset *r)
 	qsort(r->input, r->count, 5, rulecmp);
 }
 
-int main(int argc, char *argv[])
+struct pots
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
+	struct State s;
+	struct Ruleset r;
+};
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+static void day12_free(void *data)
+{
+	struct pots *p = data;
+	free(p->s.data);
+	free(p->r.input);
+	free(p);
+}
+
+static void *day12_parse(FILE *input)
+{
+	struct pots *p = calloc(1, sizeof(*p));
+	if (p)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		parse(input, &p->s, &p->r);
+		if (!p->s.data)
+		{
+			day12_free(p);
+			return NULL;
+		}
 	}
+	return p;
+}
 
-	struct State s = {0};
-	struct Ruleset r = {0};
-	parse(input, &s, &r);
-	fclose(input);
-
-	printf("Part1: %d\n", part1(&s, &r));
-	printf("Part2: %" PRId64 "\n", part2(&s, &r));
+static int day12_part1(void *data, FILE *output)
+{
+	struct pots *p = data;
+	fprintf(output, "%d", part1(&p->s, &p->r));
+	return 0;
+}
 
-	free(s.data);
-	free(r.input);
+static int day12_part2(void *data, FILE *output)
+{
+	struct pots *p = data;
+	fprintf(output, "%" PRId64, part2(&p->s, &p->r));
 	return 0;
 }
+
+const struct solver day12_solver = {
+	.name = "day12",
+	.parse = day12_parse,
+	.free = day12_free,
+	.part1 = day12_part1,
+	.part2 = day12_part2,
+};
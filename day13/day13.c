@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 struct vec
 {
 	int x;
@@ -322,33 +324,68 @@ static void map_simulate(struct map *m, struct vec *part1, struct vec *part2)
 	free(cartmap);
 }
 
-int main(int argc, char *argv[])
+struct tracks
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
+	struct map *m;
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+	/* both answers come out of a single simulation */
+	int simulated;
+	struct vec part1;
+	struct vec part2;
+};
+
+static void *day13_parse(FILE *input)
+{
+	struct tracks *t = calloc(1, sizeof(*t));
+	if (t)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		t->m = map_load(input);
+		if (!t->m)
+		{
+			free(t);
+			return NULL;
+		}
 	}
+	return t;
+}
 
-	struct map *m = map_load(input);
-	fclose(input);
-	if (!m)
+static void day13_free(void *data)
+{
+	struct tracks *t = data;
+	map_free(t->m);
+	free(t);
+}
+
+static void day13_simulate(struct tracks *t)
+{
+	if (!t->simulated)
 	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		map_simulate(t->m, &t->part1, &t->part2);
+		t->simulated = 1;
 	}
+}
 
-	struct vec part1 = {0}, part2 = {0};
-	map_simulate(m, &part1, &part2);
-	map_free(m);
-	printf("Part1: %d,%d\n", part1.x, part1.y);
-	printf("Part2: %d,%d\n", part2.x, part2.y);
+static int day13_part1(void *data, FILE *output)
+{
+	struct tracks *t = data;
+	day13_simulate(t);
+	fprintf(output, "%d,%d", t->part1.x, t->part1.y);
 	return 0;
 }
+
+static int day13_part2(void *data, FILE *output)
+{
+	struct tracks *t = data;
+	day13_simulate(t);
+	fprintf(output, "%d,%d", t->part2.x, t->part2.y);
+	return 0;
+}
+
+const struct solver day13_solver = {
+	.name = "day13",
+	.parse = day13_parse,
+	.free = day13_free,
+	.part1 = day13_part1,
+	.part2 = day13_part2,
+	.flags = SOLVER_SERIAL,
+};
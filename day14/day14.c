@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 struct recipes
 {
 	char *data;
@@ -85,36 +87,71 @@ static void make_recipes(char *txt, size_t *part1, size_t *part2)
 }
 
 
-int main(int argc, char *argv[])
+struct scoreboard
+{
+	char *line;
+
+	/* both answers come out of a single search */
+	int done;
+	size_t part1;
+	size_t part2;
+};
+
+static void *day14_parse(FILE *input)
 {
-	if (argc < 2)
+	struct scoreboard *b = calloc(1, sizeof(*b));
+	if (!b)
 	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
+		return NULL;
 	}
 
-	FILE *input = fopen(argv[1], "r");
-	if (!input)
+	size_t sline = 0;
+	if (getline(&b->line, &sline, input) == -1)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		free(b->line);
+		free(b);
+		return NULL;
 	}
+	return b;
+}
 
-	char *line = NULL;
-	size_t sline = 0;
-	int r = getline(&line, &sline, input);
-	fclose(input);
-	if (r == -1)
+static void day14_free(void *data)
+{
+	struct scoreboard *b = data;
+	free(b->line);
+	free(b);
+}
+
+static void day14_search(struct scoreboard *b)
+{
+	if (!b->done)
 	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		make_recipes(b->line, &b->part1, &b->part2);
+		b->done = 1;
 	}
+}
 
-	size_t part1, part2;
-	make_recipes(line, &part1, &part2);
-	free(line);
+static int day14_part1(void *data, FILE *output)
+{
+	struct scoreboard *b = data;
+	day14_search(b);
+	fprintf(output, "%.010zu", b->part1);
+	return 0;
+}
 
-	printf("Part1: %.010zu\n", part1);
-	printf("Part2: %zu\n", part2);
+static int day14_part2(void *data, FILE *output)
+{
+	struct scoreboard *b = data;
+	day14_search(b);
+	fprintf(output, "%zu", b->part2);
 	return 0;
 }
+
+const struct solver day14_solver = {
+	.name = "day14",
+	.parse = day14_parse,
+	.free = day14_free,
+	.part1 = day14_part1,
+	.part2 = day14_part2,
+	.flags = SOLVER_SERIAL,
+};
@@ -3,6 +3,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "prof.h"
+#include "solver.h"
+
 static const int dx[] = {0,-1,1,0};
 static const int dy[] = {-1,0,0,1};
 
@@ -85,6 +88,8 @@ static struct map *map_copy(const struct map *g)
 
 static void map_bfs(struct map *g, struct unit *u)
 {
+	PROF_SCOPE(t, "map_bfs");
+
 	/* reset the map */
 	for (size_t y = 0; y < g->height; y++)
 	{
@@ -122,6 +127,7 @@ static void map_bfs(struct map *g, struct unit *u)
 			}
 		}
 	}
+	PROF_ITEMS(t, ri);
 }
 
 static void map_move_unit(struct map *g, struct unit *u)
@@ -256,23 +262,6 @@ static int map_points(struct map *g)
 	return count;
 }
 
-static void map_print(struct map *g)
-{
-	size_t i = 0;
-	for (size_t y = 0; y < g->height; y++)
-	{
-		printf("%s", g->data[y]);
-		for (; i < g->ucount && g->units[i].y == y; i++)
-		{
-			if (g->units[i].hp > 0)
-			{
-				printf(" %c(%d)", g->units[i].class, g->units[i].hp);
-			}
-		}
-		printf("\n");
-	}
-}
-
 static int map_simulate(struct map *g, int retearly)
 {
 	int rounds = 0;
@@ -399,48 +388,56 @@ static struct map *map_load(FILE *input)
 	return g;
 }
 
-int main(int argc, char *argv[])
+static struct map *map_with_attack(const struct map *g, int attack)
 {
-	if (argc < 2)
+	struct map *c = map_copy(g);
+	if (c)
 	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
+		for (struct unit *u = c->units; u < c->units + c->ucount; u++)
+		{
+			if (u->class == 'E')
+			{
+				u->attack = attack;
+			}
+		}
 	}
+	return c;
+}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
-	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
-	}
+static void *day15_parse(FILE *input)
+{
+	return map_load(input);
+}
 
-	struct map *g = map_load(input);
-	fclose(input);
+static void day15_free(void *data)
+{
+	map_free(data);
+}
 
-	printf("Read a map of size %zu,%zu, units %zu\n", g->width, g->height, g->ucount);
-	printf("Answer1:\n");
-	struct map *c = map_copy(g);
+static int day15_part1(void *data, FILE *output)
+{
+	struct map *c = map_copy(data);
+	if (!c)
+	{
+		return -1;
+	}
 	int rounds = map_simulate(c, 0);
-	map_print(c);
-	int points = map_points(c);
-	printf("Rounds %d, points %d\n", rounds, points);
-	printf("Outcome of the battle %d with attack level = 3\n", rounds * points);
+	fprintf(output, "%d", rounds * map_points(c));
 	map_free(c);
+	return 0;
+}
 
+static int day15_part2(void *data, FILE *output)
+{
 	/* find the minimum attack level by bisecting */
 	int low = 4, high = 200;
 	while (low < high)
 	{
 		int attack = low + (high - low) / 2;
-		printf("Trying with attack level %d...\n", attack);
-
-		c = map_copy(g);
-		for (struct unit *u = c->units; u < c->units + c->ucount; u++)
+		struct map *c = map_with_attack(data, attack);
+		if (!c)
 		{
-			if (u->class == 'E')
-			{
-				u->attack = attack;
-			}
+			return -1;
 		}
 		map_simulate(c, 1);
 		if (c->goblins)
@@ -453,20 +450,22 @@ int main(int argc, char *argv[])
 		}
 		map_free(c);
 	}
-	for (struct unit *u = g->units; u < g->units + g->ucount; u++)
+
+	struct map *c = map_with_attack(data, high);
+	if (!c)
 	{
-		if (u->class == 'E')
-		{
-			u->attack = high;
-		}
+		return -1;
 	}
-	rounds = map_simulate(g, 0);
-	map_print(g);
-	points = map_points(g);
-	printf("Minimum attack level: %d\n", high);
-	printf("Rounds %d, points %d\n", rounds, points);
-	printf("Outcome of the battle %d with attack level = %d\n", rounds * points, high);
-
-	map_free(g);
+	int rounds = map_simulate(c, 0);
+	fprintf(output, "%d", rounds * map_points(c));
+	map_free(c);
 	return 0;
 }
+
+const struct solver day15_solver = {
+	.name = "day15",
+	.parse = day15_parse,
+	.free = day15_free,
+	.part1 = day15_part1,
+	.part2 = day15_part2,
+};
@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 enum
 {
 	OP_ADDR,
@@ -97,69 +99,143 @@ static void solve(char m[OP_COUNT][OP_COUNT], int opmap[OP_COUNT])
 	}
 }
 
-int main(int argc, char *argv[])
+struct sample
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
+	int before[4];
+	int instr[4];
+	int after[4];
+};
+
+struct manual
+{
+	struct sample *samples;
+	size_t scount;
+	size_t ssize;
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+	int (*program)[4];
+	size_t pcount;
+	size_t psize;
+};
+
+static void day16_free(void *data)
+{
+	struct manual *man = data;
+	free(man->program);
+	free(man->samples);
+	free(man);
+}
+
+static void *day16_parse(FILE *input)
+{
+	struct manual *man = calloc(1, sizeof(*man));
+	if (!man)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		return NULL;
 	}
 
-	char m[OP_COUNT][OP_COUNT];
-	memset(m, 0, sizeof(m));
-
-	size_t three_or_more = 0;
 	for (;;)
 	{
-		int before[4];
-		int instr[4];
-		int after[4];
+		struct sample t;
 		int r = fscanf(input, " Before: [%d, %d, %d, %d]",
-			       before+0, before+1, before+2, before+3);
+			       t.before+0, t.before+1, t.before+2, t.before+3);
 		if (r != 4)
 		{
 			break;
 		}
 		r = fscanf(input, " %d %d %d %d",
-			   instr+0, instr+1, instr+2, instr+3);
+			   t.instr+0, t.instr+1, t.instr+2, t.instr+3);
 		if (r != 4)
 		{
 			break;
 		}
 		r = fscanf(input, " After: [%d, %d, %d, %d]",
-			   after+0, after+1, after+2, after+3);
+			   t.after+0, t.after+1, t.after+2, t.after+3);
 		if (r != 4)
 		{
 			break;
 		}
 
-		if (process_sample(m, before, instr, after) >= 3)
+		if (man->scount == man->ssize)
+		{
+			size_t newsize = man->ssize ? man->ssize * 2 : 64;
+			struct sample *newsamples = realloc(man->samples, newsize * sizeof(newsamples[0]));
+			if (!newsamples)
+			{
+				day16_free(man);
+				return NULL;
+			}
+			man->samples = newsamples;
+			man->ssize = newsize;
+		}
+		man->samples[man->scount++] = t;
+	}
+
+	int instr[4];
+	while (fscanf(input, " %d %d %d %d", instr+0, instr+1, instr+2, instr+3) == 4)
+	{
+		if (man->pcount == man->psize)
+		{
+			size_t newsize = man->psize ? man->psize * 2 : 64;
+			int (*newprogram)[4] = realloc(man->program, newsize * sizeof(newprogram[0]));
+			if (!newprogram)
+			{
+				day16_free(man);
+				return NULL;
+			}
+			man->program = newprogram;
+			man->psize = newsize;
+		}
+		memcpy(man->program[man->pcount++], instr, sizeof(instr));
+	}
+	return man;
+}
+
+static int day16_part1(void *data, FILE *output)
+{
+	struct manual *man = data;
+	char m[OP_COUNT][OP_COUNT];
+	memset(m, 0, sizeof(m));
+
+	size_t three_or_more = 0;
+	for (struct sample *t = man->samples; t < man->samples + man->scount; t++)
+	{
+		if (process_sample(m, t->before, t->instr, t->after) >= 3)
 		{
 			three_or_more++;
 		}
+	}
+	fprintf(output, "%zu", three_or_more);
+	return 0;
+}
 
+static int day16_part2(void *data, FILE *output)
+{
+	struct manual *man = data;
+	char m[OP_COUNT][OP_COUNT];
+	memset(m, 0, sizeof(m));
+	for (struct sample *t = man->samples; t < man->samples + man->scount; t++)
+	{
+		process_sample(m, t->before, t->instr, t->after);
 	}
-	printf("Part1: %zu\n", three_or_more);
 
 	int opmap[OP_COUNT];
-       	solve(m, opmap);
+	solve(m, opmap);
 
 	/* execute the program */
-	int op, a, b, c;
 	int regs[4] = {0};
-	while (fscanf(input, " %d %d %d %d", &op, &a, &b, &c) == 4)
+	for (size_t i = 0; i < man->pcount; i++)
 	{
-		compute(regs, opmap[op], a, b, c);
+		int *instr = man->program[i];
+		compute(regs, opmap[instr[0]], instr[1], instr[2], instr[3]);
 	}
-	fclose(input);
-
-	printf("Part2: %d\n", regs[0]);
+	fprintf(output, "%d", regs[0]);
 	return 0;
 }
+
+const struct solver day16_solver = {
+	.name = "day16",
+	.parse = day16_parse,
+	.free = day16_free,
+	.part1 = day16_part1,
+	.part2 = day16_part2,
+};
@@ -4,6 +4,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "prof.h"
+#include "solver.h"
+
 #define TABLE_SIZE 131071
 
 enum
@@ -25,7 +28,7 @@ static const struct pos RIGHT = (struct pos){1, 0};
 static const struct pos DOWN = (struct pos){0, 1};
 static const struct pos LEFT = (struct pos){-1, 0};
 
-struct pos add(struct pos a, struct pos b)
+static struct pos add(struct pos a, struct pos b)
 {
 	return (struct pos){a.x+b.x, a.y+b.y};
 }
@@ -50,12 +53,16 @@ struct map
 
 static struct helem *map_find(const struct map *m, struct pos p)
 {
+	PROF_SCOPE(t, "map_find");
 	size_t idx = hashfn(p) % TABLE_SIZE;
 	struct helem *e = m->table[idx];
+	size_t chain = 0;
 	while (e && memcmp(&e->key, &p, sizeof(p)))
 	{
 		e = e->next;
+		chain++;
 	}
+	PROF_HIST("map_find chain", chain);
 	return e;
 }
 
@@ -248,34 +255,71 @@ static void map_fill(struct map *m, struct pos p)
 	}
 }
 
-int main(int argc, char *argv[])
+struct ground
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
+	struct map *m;
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+	/* both answers come out of a single fill */
+	int filled;
+	int water;
+	int sand;
+};
+
+static void *day17_parse(FILE *input)
+{
+	struct ground *g = calloc(1, sizeof(*g));
+	if (g)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		g->m = map_load(input);
+		if (!g->m)
+		{
+			free(g);
+			return NULL;
+		}
 	}
+	return g;
+}
 
-	struct map *m = map_load(input);
-	fclose(input);
-	(void)map_print;
-	/* map_print(m); */
+static void day17_free(void *data)
+{
+	struct ground *g = data;
+	map_free(g->m);
+	free(g);
+}
 
-	map_fill(m, (struct pos){500, 0});
-	/* map_print(m); */
+static void day17_fill(struct ground *g)
+{
+	if (!g->filled)
+	{
+		(void)map_print;
+		map_fill(g->m, (struct pos){500, 0});
+		/* map_print(g->m); */
+		map_count(g->m, &g->water, &g->sand);
+		g->filled = 1;
+	}
+}
 
-	int water, sand;
-	map_count(m, &water, &sand);
-	map_free(m);
+static int day17_part1(void *data, FILE *output)
+{
+	struct ground *g = data;
+	day17_fill(g);
+	fprintf(output, "%d", g->sand + g->water);
+	return 0;
+}
 
-	printf("Part1: %d\n", sand + water);
-	printf("Part2: %d\n", water);
+static int day17_part2(void *data, FILE *output)
+{
+	struct ground *g = data;
+	day17_fill(g);
+	fprintf(output, "%d", g->water);
 	return 0;
 }
+
+const struct solver day17_solver = {
+	.name = "day17",
+	.parse = day17_parse,
+	.free = day17_free,
+	.part1 = day17_part1,
+	.part2 = day17_part2,
+	.flags = SOLVER_SERIAL,
+};
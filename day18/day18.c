@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 #define MAXLEN 50
 
 enum
@@ -125,27 +127,37 @@ static void map_print(struct map *m)
 	}
 }
 
-int main(int argc, char *argv[])
+static void *day18_parse(FILE *input)
 {
-	(void)map_print;
-	if (argc < 2)
+	struct map *m = malloc(sizeof(*m));
+	if (m)
 	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
+		map_load(m, input);
+		if (!m->height)
+		{
+			free(m);
+			return NULL;
+		}
 	}
+	return m;
+}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+static int day18_part1(void *data, FILE *output)
+{
+	struct map m = *(struct map *)data;
+	for (int i = 0; i < 10; i++)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		map_next(&m);
 	}
-	struct map tortoise;
-	map_load(&tortoise, input);
-	fclose(input);
+	fprintf(output, "%d", map_resources(&m));
+	return 0;
+}
 
+static int day18_part2(void *data, FILE *output)
+{
+	(void)map_print;
+	struct map tortoise = *(struct map *)data;
 	struct map hare = tortoise;
-	size_t part1 = 0;
 	size_t steps = 0;
 	do
 	{
@@ -155,10 +167,6 @@ int main(int argc, char *argv[])
 		map_next(&hare);
 		map_next(&hare);
 		steps++;
-		if (steps == 10)
-		{
-			part1 = map_resources(&tortoise);
-		}
 	} while (!map_eq(&tortoise, &hare));
 
 	size_t lam = 0;
@@ -174,9 +182,14 @@ int main(int argc, char *argv[])
 	{
 		map_next(&tortoise);
 	}
-	size_t part2 = map_resources(&tortoise);
-
-	printf("Part1: %zu\n", part1);
-	printf("Part2: %zu\n", part2);
+	fprintf(output, "%d", map_resources(&tortoise));
 	return 0;
 }
+
+const struct solver day18_solver = {
+	.name = "day18",
+	.parse = day18_parse,
+	.free = free,
+	.part1 = day18_part1,
+	.part2 = day18_part2,
+};
@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 enum
 {
 	OP_ADDI,
@@ -203,37 +205,62 @@ static struct program *program_load(FILE *input)
 	return p;
 }
 
-int main(int argc, char *argv[])
+struct device
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
+	int boundreg;
+	struct program *p;
+};
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+static void *day19_parse(FILE *input)
+{
+	struct device *d = malloc(sizeof(*d));
+	if (!d)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		return NULL;
 	}
-
-	struct cpu cpu = {0};
-	fscanf(input, "#ip %d", &cpu.boundreg);
-	struct program *p = program_load(input);
-	fclose(input);
-	if (!p)
+	d->boundreg = 0;
+	fscanf(input, "#ip %d", &d->boundreg);
+	d->p = program_load(input);
+	if (!d->p)
 	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		free(d);
+		return NULL;
 	}
+	return d;
+}
 
-	printf("Part1: %" PRId64 "\n", cpu_execute(&cpu, p, 1));
+static void day19_free(void *data)
+{
+	struct device *d = data;
+	program_free(d->p);
+	free(d);
+}
 
+static int day19_part1(void *data, FILE *output)
+{
+	struct device *d = data;
+	struct cpu cpu;
+	cpu.boundreg = d->boundreg;
 	cpu_reset(&cpu);
-	cpu.regs[0] = 1;
-	printf("Part2: %" PRId64 "\n", cpu_execute(&cpu, p, 1));
-	program_free(p);
+	fprintf(output, "%" PRId64, cpu_execute(&cpu, d->p, 1));
+	return 0;
+}
 
+static int day19_part2(void *data, FILE *output)
+{
+	struct device *d = data;
+	struct cpu cpu;
+	cpu.boundreg = d->boundreg;
+	cpu_reset(&cpu);
+	cpu.regs[0] = 1;
+	fprintf(output, "%" PRId64, cpu_execute(&cpu, d->p, 1));
 	return 0;
 }
+
+const struct solver day19_solver = {
+	.name = "day19",
+	.parse = day19_parse,
+	.free = day19_free,
+	.part1 = day19_part1,
+	.part2 = day19_part2,
+};
@@ -1,134 +1,493 @@
-#include <ctype.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-struct boxid
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "input.h"
+#include "solver.h"
+
+/*
+ * All the ids in one block, as rows of the same stride padded with
+ * zeros. The stride has room for the longest id and its terminator
+ * and is a multiple of 32 so that rows stay aligned for vector loads.
+ */
+#define ROW_ALIGN 32
+
+struct boxids
 {
-	struct boxid *next;
-	char id[0];
+	char *rows;
+	size_t stride;
+	size_t count;
 };
 
-static struct boxid *load(FILE *input)
+static const char *boxids_row(const struct boxids *b, size_t i)
+{
+	return b->rows + i * b->stride;
+}
+
+static void boxids_free(struct boxids *b)
+{
+	if (b)
+	{
+		free(b->rows);
+		free(b);
+	}
+}
+
+/* one id per line, lines are measured first and then copied in place */
+static struct boxids *load(FILE *input)
 {
-	struct boxid *head = NULL;
-	struct boxid **tail = &head;
+	struct input in;
+	if (input_map(&in, input) < 0)
+	{
+		return NULL;
+	}
 
-	size_t size = 0;
-	char *line = NULL;
-	while (getline(&line, &size, input)!=-1)
+	size_t count = 0;
+	size_t maxlen = 0;
+	for (const char *p = in.data; p < in.end; count++)
 	{
-		/* chop off the trailing \n */
-		size_t len = strlen(line);
-		if (line[len-1] == '\n')
+		const char *eol = memchr(p, '\n', in.end - p);
+		size_t len = (eol ? eol : in.end) - p;
+		if (maxlen < len)
 		{
-			line[len-1] = 0;
-			len--;
+			maxlen = len;
 		}
+		p += len + 1;
+	}
+
+	struct boxids *b = calloc(1, sizeof(*b));
+	if (!b || count == 0)
+	{
+		free(b);
+		input_unmap(&in);
+		return NULL;
+	}
+	b->stride = (maxlen + ROW_ALIGN) & ~(size_t)(ROW_ALIGN - 1);
+	b->count = count;
+	b->rows = aligned_alloc(ROW_ALIGN, count * b->stride);
+	if (!b->rows)
+	{
+		free(b);
+		input_unmap(&in);
+		return NULL;
+	}
+	memset(b->rows, 0, count * b->stride);
+
+	char *row = b->rows;
+	for (const char *p = in.data; p < in.end; row += b->stride)
+	{
+		const char *eol = memchr(p, '\n', in.end - p);
+		size_t len = (eol ? eol : in.end) - p;
+		memcpy(row, p, len);
+		p += len + 1;
+	}
+	input_unmap(&in);
+	return b;
+}
+
+/*
+ * Kernels on rows. letters() returns bit 0 if some letter of the id
+ * occurs exactly twice and bit 1 if some letter occurs exactly three
+ * times. mismatch() counts the differing bytes of two rows, padding
+ * included, which is zero on both sides.
+ */
+struct kernel
+{
+	const char *name;
+	int (*supported)(void);
+	unsigned (*letters)(const char *row);
+	size_t (*mismatch)(const char *a, const char *b, size_t stride);
+};
+
+static int always(void)
+{
+	return 1;
+}
+
+#define BYTES(x) (0x0101010101010101ULL * (x))
 
-		/* add the string to the list */
-		struct boxid *b = malloc(len+1+sizeof(*b));
-		if (!b)
+/* bytes of w equal to x, as their top bit */
+static uint64_t bytes_equal(uint64_t w, unsigned x)
+{
+	w ^= BYTES(x);
+	return (w - BYTES(1)) & ~w & BYTES(0x80);
+}
+
+/* byte counters for 'a' to 'z', like the vector kernels, tested 8 at a time */
+static unsigned letters_scalar(const char *row)
+{
+	uint64_t packed[4] = {0};
+	unsigned char *count = (unsigned char *)packed;
+	for (const char *s = row; *s; s++)
+	{
+		unsigned letter = (unsigned char)(*s - 'a');
+		if (letter < 26)
 		{
-			break;
+			count[letter]++;
 		}
-		strcpy(b->id, line);
-		b->next = NULL;
-		*tail = b;
-		tail = &b->next;
 	}
-	free(line);
-	return head;
+	uint64_t twos = 0, threes = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		twos |= bytes_equal(packed[i], 2);
+		threes |= bytes_equal(packed[i], 3);
+	}
+	return (twos != 0) | (threes != 0) << 1;
 }
 
-static int part1(struct boxid *lst)
+static size_t mismatch_scalar(const char *a, const char *b, size_t stride)
 {
-	size_t twos = 0;
-	size_t threes = 0;
-	size_t count['z'-'a'+1];
-	for (; lst; lst = lst->next)
+	size_t count = 0;
+	for (size_t i = 0; i < stride; i++)
+	{
+		count += a[i] != b[i];
+	}
+	return count;
+}
+
+#ifdef __SSE2__
+/* one counter per letter in two vectors, bumped by comparing every letter at once */
+static unsigned letters_sse2(const char *row)
+{
+	const __m128i lo = _mm_setr_epi8('a', 'b', 'c', 'd', 'e', 'f', 'g', 'h',
+					 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p');
+	const __m128i hi = _mm_setr_epi8('q', 'r', 's', 't', 'u', 'v', 'w', 'x',
+					 'y', 'z', 0, 0, 0, 0, 0, 0);
+	__m128i clo = _mm_setzero_si128();
+	__m128i chi = _mm_setzero_si128();
+	for (const char *s = row; *s; s++)
+	{
+		__m128i c = _mm_set1_epi8(*s);
+		clo = _mm_sub_epi8(clo, _mm_cmpeq_epi8(lo, c));
+		chi = _mm_sub_epi8(chi, _mm_cmpeq_epi8(hi, c));
+	}
+	const __m128i two = _mm_set1_epi8(2);
+	const __m128i three = _mm_set1_epi8(3);
+	int twos = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(clo, two),
+						  _mm_cmpeq_epi8(chi, two)));
+	int threes = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(clo, three),
+						    _mm_cmpeq_epi8(chi, three)));
+	return (twos != 0) | (threes != 0) << 1;
+}
+
+static size_t mismatch_sse2(const char *a, const char *b, size_t stride)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < stride; i += 16)
+	{
+		__m128i va = _mm_load_si128((const __m128i *)(a + i));
+		__m128i vb = _mm_load_si128((const __m128i *)(b + i));
+		unsigned equal = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+		count += __builtin_popcount(~equal & 0xffff);
+	}
+	return count;
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+static int avx2_supported(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("avx2")))
+static unsigned letters_avx2(const char *row)
+{
+	const __m256i letters = _mm256_setr_epi8(
+		'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
+		'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
+		0, 0, 0, 0, 0, 0);
+	__m256i count = _mm256_setzero_si256();
+	for (const char *s = row; *s; s++)
+	{
+		count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(letters, _mm256_set1_epi8(*s)));
+	}
+	int twos = _mm256_movemask_epi8(_mm256_cmpeq_epi8(count, _mm256_set1_epi8(2)));
+	int threes = _mm256_movemask_epi8(_mm256_cmpeq_epi8(count, _mm256_set1_epi8(3)));
+	return (twos != 0) | (threes != 0) << 1;
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t mismatch_avx2(const char *a, const char *b, size_t stride)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < stride; i += 32)
+	{
+		__m256i va = _mm256_load_si256((const __m256i *)(a + i));
+		__m256i vb = _mm256_load_si256((const __m256i *)(b + i));
+		unsigned equal = _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+		count += __builtin_popcount(~equal);
+	}
+	return count;
+}
+#endif
+
+/* fastest first */
+static const struct kernel kernels[] = {
+#if defined(__x86_64__) || defined(__i386__)
+	{ "avx2", avx2_supported, letters_avx2, mismatch_avx2 },
+#endif
+#ifdef __SSE2__
+	{ "sse2", always, letters_sse2, mismatch_sse2 },
+#endif
+	{ "scalar", always, letters_scalar, mismatch_scalar },
+};
+
+#define KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+/* NULL picks the fastest supported kernel, -k forces one */
+static const struct kernel *kernel;
+static int benchmark;
+
+static const struct kernel *kernel_get(void)
+{
+	for (size_t i = 0; !kernel && i < KERNELS; i++)
 	{
-		memset(count, 0, sizeof(count));
-		for (char *s = lst->id; *s; s++)
+		if (kernels[i].supported())
 		{
-			count[*s-'a']++;
+			return kernels + i;
 		}
-		int found2 = 0;
-		int found3 = 0;
-		for (size_t i = 0; i < 'z'-'a'+1; i++)
+	}
+	return kernel;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* time every supported kernel on the rows and check that they agree */
+static void kernels_bench(const struct boxids *b, FILE *report)
+{
+	fprintf(report, "%-8s %12s %12s\n", "kernel", "letters ns", "mismatch ns");
+	unsigned long long expect[2] = {0};
+	int first = 1;
+	for (size_t k = 0; k < KERNELS; k++)
+	{
+		const struct kernel *kn = kernels + k;
+		if (!kn->supported())
+		{
+			continue;
+		}
+		unsigned long long sum[2] = {0};
+		uint64_t best[2] = { UINT64_MAX, UINT64_MAX };
+		for (int run = 0; run < 5; run++)
 		{
-			switch (count[i])
+			uint64_t start = now_ns();
+			for (size_t i = 0; i < b->count; i++)
+			{
+				sum[0] += kn->letters(boxids_row(b, i));
+			}
+			uint64_t mid = now_ns();
+			for (size_t i = 1; i < b->count; i++)
 			{
-			case 2: found2 = 1; break;
-			case 3: found3 = 1; break;
+				sum[1] += kn->mismatch(boxids_row(b, i - 1), boxids_row(b, i), b->stride);
 			}
+			uint64_t end = now_ns();
+			best[0] = best[0] < mid - start ? best[0] : mid - start;
+			best[1] = best[1] < end - mid ? best[1] : end - mid;
+		}
+		fprintf(report, "%-8s %12.2f %12.2f%s\n", kn->name,
+			(double)best[0] / b->count,
+			(double)best[1] / (b->count > 1 ? b->count - 1 : 1),
+			!first && (sum[0] != expect[0] || sum[1] != expect[1]) ? " MISMATCH" : "");
+		if (first)
+		{
+			expect[0] = sum[0];
+			expect[1] = sum[1];
+			first = 0;
 		}
-		if (found2) twos++;
-		if (found3) threes++;
+	}
+}
+
+static int part1(const struct boxids *b)
+{
+	const struct kernel *kn = kernel_get();
+	size_t twos = 0;
+	size_t threes = 0;
+	for (size_t i = 0; i < b->count; i++)
+	{
+		unsigned found = kn->letters(boxids_row(b, i));
+		twos += found & 1;
+		threes += found >> 1;
 	}
 	return twos * threes;
 }
 
-static char *part2(struct boxid *lst)
+/*
+ * Two ids one letter apart are equal once that letter is deleted. For
+ * every position k the ids are hashed with letter k left out and only
+ * the ids colliding in a table of those hashes are compared. With a
+ * polynomial hash the hash without letter k is the full hash minus the
+ * contribution of letter k, so every position costs O(1) per id.
+ */
+#define HASH_BASE 0x100000001b3ULL
+
+struct key
+{
+	const char *id;
+	size_t len;
+	uint64_t hash;
+};
+
+struct slot
+{
+	uint64_t hash;		/* hash of the id without letter k */
+	const struct key *key;	/* NULL if empty */
+};
+
+/* equal except for letter k, which differs */
+static int key_match(const struct kernel *kn, const struct key *a,
+		     const struct key *b, size_t k, size_t stride)
+{
+	return a->len == b->len && a->id[k] != b->id[k] &&
+		kn->mismatch(a->id, b->id, stride) == 1;
+}
+
+/* print the common letters of every pair, returns the number of pairs */
+static long part2(const struct boxids *b, FILE *output)
 {
-	for (struct boxid *a = lst->next; a; a = a->next)
+	const struct kernel *kn = kernel_get();
+	size_t count = b->count;
+	size_t maxlen = 0;
+	size_t size = 16;
+	while (size < 2 * count)
+	{
+		size *= 2;
+	}
+	struct key *keys = malloc(count * sizeof(keys[0]));
+	struct slot *table = malloc(size * sizeof(table[0]));
+	if (!keys || !table)
+	{
+		free(table);
+		free(keys);
+		return -1;
+	}
+
+	struct key *key = keys;
+	for (size_t j = 0; j < count; j++, key++)
 	{
-		for (struct boxid *b = lst; b != a; b = b->next)
+		key->id = boxids_row(b, j);
+		key->len = strlen(key->id);
+		key->hash = key->len;
+		for (size_t i = 0; i < key->len; i++)
 		{
-			char *sa = a->id;
-			char *sb = b->id;
-			size_t last = 0;
-			size_t count = 0;
-			size_t i;
-			for (i = 0; *sa && *sb; i++)
+			key->hash = key->hash * HASH_BASE + (unsigned char)key->id[i];
+		}
+		if (maxlen < key->len)
+		{
+			maxlen = key->len;
+		}
+	}
+
+	/* power[i] weighs the letter followed by i others */
+	uint64_t *power = malloc((maxlen + 1) * sizeof(power[0]));
+	if (!power)
+	{
+		free(table);
+		free(keys);
+		return -1;
+	}
+	power[0] = 1;
+	for (size_t i = 1; i <= maxlen; i++)
+	{
+		power[i] = power[i - 1] * HASH_BASE;
+	}
+
+	long pairs = 0;
+	for (size_t k = 0; k < maxlen; k++)
+	{
+		memset(table, 0, size * sizeof(table[0]));
+		for (key = keys; key < keys + count; key++)
+		{
+			if (k >= key->len)
 			{
-				if (*sa++ != *sb++)
-				{
-					count++;
-					last = i;
-				}
+				continue;
 			}
-			if (count == 1)
+			uint64_t weight = power[key->len - k - 1];
+			uint64_t hash = key->hash - (unsigned char)key->id[k] * weight;
+
+			size_t i = (hash ^ hash >> 29) & (size - 1);
+			for (; table[i].key; i = (i + 1) & (size - 1))
 			{
-				memmove(b->id+last, b->id+last+1, i-last);
-				return b->id;
+				if (table[i].hash == hash && key_match(kn, table[i].key, key, k, b->stride))
+				{
+					const char *id = table[i].key->id;
+					fprintf(output, "%s%.*s%s", pairs++ ? "\n" : "",
+						(int)k, id, id + k + 1);
+				}
 			}
+			table[i].hash = hash;
+			table[i].key = key;
 		}
 	}
-	return "";
+	free(power);
+	free(table);
+	free(keys);
+	return pairs;
 }
 
-int main(int argc, char *argv[])
+static void *day2_parse(FILE *input)
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s path\n", argv[0]);
-		return 1;
-	}
+	return load(input);
+}
+
+static void day2_free(void *data)
+{
+	boxids_free(data);
+}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+static int day2_option(int opt, const char *arg)
+{
+	if (opt == 'B')
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		benchmark = 1;
+		return 0;
 	}
-
-	struct boxid *lst = load(input);
-	fclose(input);
-	if (!lst)
+	for (size_t i = 0; i < KERNELS; i++)
 	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		if (!strcmp(arg, kernels[i].name) && kernels[i].supported())
+		{
+			kernel = kernels + i;
+			return 0;
+		}
 	}
+	return -1;
+}
 
-	printf("Part1: %d\n", part1(lst));
-	printf("Part2: %s\n", part2(lst));
-	while (lst)
+static int day2_part1(void *data, FILE *output)
+{
+	if (benchmark)
 	{
-		struct boxid *tmp = lst;
-		lst = lst->next;
-		free(tmp);
+		kernels_bench(data, stderr);
 	}
-
+	fprintf(output, "%d", part1(data));
 	return 0;
 }
+
+static int day2_part2(void *data, FILE *output)
+{
+	/* no match leaves the answer empty */
+	return part2(data, output) < 0 ? -1 : 0;
+}
+
+const struct solver day2_solver = {
+	.name = "day2",
+	.options = "Bk:",
+	.usage = "[-B] [-k avx2|sse2|scalar]",
+	.option = day2_option,
+	.parse = day2_parse,
+	.free = day2_free,
+	.part1 = day2_part1,
+	.part2 = day2_part2,
+};
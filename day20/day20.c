@@ -4,6 +4,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "prof.h"
+#include "solver.h"
+
 #define TABLE_SIZE 32771
 
 struct pos
@@ -34,12 +37,16 @@ struct map
 
 static struct helem *map_find(const struct map *m, struct pos p)
 {
+	PROF_SCOPE(t, "map_find");
 	size_t idx = hashpos(p) % TABLE_SIZE;
 	struct helem *e = m->table[idx];
+	size_t chain = 0;
 	while (e && memcmp(&e->key, &p, sizeof(p)))
 	{
 		e = e->next;
+		chain++;
 	}
+	PROF_HIST("map_find chain", chain);
 	return e;
 }
 
@@ -228,39 +235,79 @@ static void map_free(struct map *m)
 	}
 }
 
-int main(int argc, char *argv[])
+struct facility
 {
-	if (argc < 2)
+	struct map *m;
+
+	/* both answers come out of a single BFS */
+	int done;
+	size_t part1;
+	size_t part2;
+};
+
+static void *day20_parse(FILE *input)
+{
+	size_t sline = 0;
+	char *line = NULL;
+	if (getline(&line, &sline, input) == -1)
 	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
+		free(line);
+		return NULL;
 	}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+	struct facility *f = calloc(1, sizeof(*f));
+	if (f)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		f->m = map_new(line);
+		if (!f->m)
+		{
+			free(f);
+			f = NULL;
+		}
 	}
-
-	size_t sline = 0;
-	char *line = NULL;
-	getline(&line, &sline, input);
-	fclose(input);
-	struct map *m = map_new(line);
 	free(line);
-	if (!m)
+	return f;
+}
+
+static void day20_free(void *data)
+{
+	struct facility *f = data;
+	map_free(f->m);
+	free(f);
+}
+
+static void day20_bfs(struct facility *f)
+{
+	if (!f->done)
 	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		(void)map_print;
+		/* map_print(f->m); */
+		map_bfs(f->m, &f->part1, &f->part2);
+		f->done = 1;
 	}
+}
 
-	(void)map_print;
-	/* map_print(m); */
-	size_t part1, part2;
-	map_bfs(m, &part1, &part2);
-	map_free(m);
+static int day20_part1(void *data, FILE *output)
+{
+	struct facility *f = data;
+	day20_bfs(f);
+	fprintf(output, "%zu", f->part1);
+	return 0;
+}
 
-	printf("Part1: %zu\nPart2: %zu\n", part1, part2);
+static int day20_part2(void *data, FILE *output)
+{
+	struct facility *f = data;
+	day20_bfs(f);
+	fprintf(output, "%zu", f->part2);
 	return 0;
 }
+
+const struct solver day20_solver = {
+	.name = "day20",
+	.parse = day20_parse,
+	.free = day20_free,
+	.part1 = day20_part1,
+	.part2 = day20_part2,
+	.flags = SOLVER_SERIAL,
+};
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 enum
 {
 	OP_ADDI,
@@ -25,7 +27,7 @@ enum
 	OP_COUNT,
 };
 
-const char *symbols[] = {
+static const char *symbols[] = {
 	"addi",
 	"addr",
 	"bani",
@@ -233,30 +235,72 @@ static struct program *program_load(FILE *input)
 	return p;
 }
 
-int main(int argc, char *argv[])
+struct device
+{
+	struct cpu cpu;
+	struct program *p;
+
+	/* both answers come out of a single cycle search */
+	int done;
+	int part1;
+	int part2;
+};
+
+static void *day21_parse(FILE *input)
 {
-	if (argc < 2)
+	struct device *d = calloc(1, sizeof(*d));
+	if (!d)
 	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
+		return NULL;
 	}
-
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+	fscanf(input, "#ip %d", &d->cpu.ipreg);
+	d->p = program_load(input);
+	if (!d->p || d->p->count <= 30)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		program_free(d->p);
+		free(d);
+		return NULL;
 	}
+	return d;
+}
 
-	struct cpu cpu = {0};
-	fscanf(input, "#ip %d", &cpu.ipreg);
-	struct program *p = program_load(input);
-	fclose(input);
+static void day21_free(void *data)
+{
+	struct device *d = data;
+	program_free(d->p);
+	free(d);
+}
 
-	int part1, part2;
-	cpu_find_values(&cpu, p, &part1, &part2);
-	program_free(p);
+static void day21_search(struct device *d)
+{
+	if (!d->done)
+	{
+		cpu_find_values(&d->cpu, d->p, &d->part1, &d->part2);
+		d->done = 1;
+	}
+}
 
-	printf("Part1: %d\nPart2: %d\n", part1, part2);
+static int day21_part1(void *data, FILE *output)
+{
+	struct device *d = data;
+	day21_search(d);
+	fprintf(output, "%d", d->part1);
 	return 0;
 }
+
+static int day21_part2(void *data, FILE *output)
+{
+	struct device *d = data;
+	day21_search(d);
+	fprintf(output, "%d", d->part2);
+	return 0;
+}
+
+const struct solver day21_solver = {
+	.name = "day21",
+	.parse = day21_parse,
+	.free = day21_free,
+	.part1 = day21_part1,
+	.part2 = day21_part2,
+	.flags = SOLVER_SERIAL,
+};
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 /* tools */
 #define NONE	  0
 #define TORCH	  1
@@ -417,31 +419,34 @@ static int map_astar(struct map *m)
 	return 0;
 }
 
-int main(int argc, char *argv[])
+static void *day22_parse(FILE *input)
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
+	return map_load(input);
+}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
-	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
-	}
+static void day22_free(void *data)
+{
+	map_free(data);
+}
 
-	struct map *m = map_load(input);
-	fclose(input);
-	if (!m)
-	{
-		fprintf(stderr, "Cannot parse the map from the given file\n");
-		return 1;
-	}
+static int day22_part1(void *data, FILE *output)
+{
+	fprintf(output, "%d", map_rect_risk(data));
+	return 0;
+}
 
-	printf("Part1: %d\n", map_rect_risk(m));
-	printf("Part2: %d\n", map_astar(m));
-	map_free(m);
+static int day22_part2(void *data, FILE *output)
+{
+	fprintf(output, "%d", map_astar(data));
 	return 0;
 }
+
+/* the A* search extends the erosion map while part1 may be reading it */
+const struct solver day22_solver = {
+	.name = "day22",
+	.parse = day22_parse,
+	.free = day22_free,
+	.part1 = day22_part1,
+	.part2 = day22_part2,
+	.flags = SOLVER_SERIAL,
+};
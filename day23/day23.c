@@ -4,6 +4,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "input.h"
+#include "prof.h"
+#include "solver.h"
+
 struct bot
 {
 	int64_t x, y, z, r;
@@ -34,9 +38,17 @@ static struct botset *botset_load(FILE *input)
 		return NULL;
 	}
 
+	struct input in;
+	if (input_map(&in, input) < 0)
+	{
+		free(bs);
+		return NULL;
+	}
+
 	int64_t maxr = INT64_MIN;
 	struct bot t;
-	while (fscanf(input, " pos=<%ld,%ld,%ld>, r=%ld", &t.x, &t.y, &t.z, &t.r) == 4)
+	while (input_next_i64(&in, &t.x) && input_next_i64(&in, &t.y) &&
+	       input_next_i64(&in, &t.z) && input_next_i64(&in, &t.r))
 	{
 		/* find the strongest */
 		if (maxr < t.r)
@@ -52,7 +64,8 @@ static struct botset *botset_load(FILE *input)
 			struct bot *newpool = realloc(bs->pool, newsize * sizeof(newpool[0]));
 			if (!newpool)
 			{
-				free(bs);
+				input_unmap(&in);
+				botset_free(bs);
 				return NULL;
 			}
 			bs->size = newsize;
@@ -60,6 +73,7 @@ static struct botset *botset_load(FILE *input)
 		}
 		bs->pool[bs->count++] = t;
 	}
+	input_unmap(&in);
 
 	return bs;
 }
@@ -118,6 +132,8 @@ static int box_cmp(const struct box *a, const struct box *b)
 
 static void box_find_botcount(struct box *box, const struct botset *bs)
 {
+	PROF_SCOPE(t, "box_find_botcount");
+	PROF_ITEMS(t, bs->count);
 	size_t count = 0;
 	for (struct bot *b = bs->pool; b != bs->pool + bs->count; b++)
 	{
@@ -270,32 +286,32 @@ static size_t part2(struct botset *bs)
 	return b.distance;
 }
 
-int main(int argc, char *argv[])
+static void *day23_parse(FILE *input)
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
-
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
-	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
-	}
+	return botset_load(input);
+}
 
-	struct botset *bs = botset_load(input);
-	fclose(input);
-	if (!bs)
-	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
-	}
+static void day23_free(void *data)
+{
+	botset_free(data);
+}
 
-	printf("Part1: %zu\n", part1(bs));
-	printf("Part2: %zu\n", part2(bs));
+static int day23_part1(void *data, FILE *output)
+{
+	fprintf(output, "%zu", part1(data));
+	return 0;
+}
 
-	botset_free(bs);
+static int day23_part2(void *data, FILE *output)
+{
+	fprintf(output, "%zu", part2(data));
 	return 0;
 }
+
+const struct solver day23_solver = {
+	.name = "day23",
+	.parse = day23_parse,
+	.free = day23_free,
+	.part1 = day23_part1,
+	.part2 = day23_part2,
+};
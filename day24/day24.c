@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 enum
 {
 	/* class of unit */
@@ -377,45 +379,42 @@ static int game_play(struct game *g, int boost, size_t *units)
 	return infection == 0;
 }
 
-int main(int argc, char *argv[])
+static void *day24_parse(FILE *input)
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
-
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
-	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
-	}
-
-	struct game *g = game_load(input);
-	fclose(input);
+	return game_load(input);
+}
 
-	if (!g)
-	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
-	}
+static void day24_free(void *data)
+{
+	game_free(data);
+}
 
+static int day24_part1(void *data, FILE *output)
+{
 	size_t units;
-	struct game *c = game_clone(g);
-	if (c)
+	struct game *c = game_clone(data);
+	if (!c)
 	{
-		game_play(c, 0, &units);
-		game_free(c);
-		printf("Part1: %zu\n", units);
+		return -1;
 	}
+	game_play(c, 0, &units);
+	game_free(c);
+	fprintf(output, "%zu", units);
+	return 0;
+}
 
+static int day24_part2(void *data, FILE *output)
+{
 	int low = 0;
 	int high = 100000;
 	while (low < high)
 	{
 		int mid = low + (high - low) / 2;
-		c = game_clone(g);
+		struct game *c = game_clone(data);
+		if (!c)
+		{
+			return -1;
+		}
 		if (game_play(c, mid, NULL))
 		{
 			high = mid;
@@ -427,10 +426,22 @@ int main(int argc, char *argv[])
 		game_free(c);
 	}
 
-	game_play(g, low, &units);
-	game_free(g);
-
-	printf("Part2: %zu\n", units);
-
+	size_t units;
+	struct game *c = game_clone(data);
+	if (!c)
+	{
+		return -1;
+	}
+	game_play(c, low, &units);
+	game_free(c);
+	fprintf(output, "%zu", units);
 	return 0;
 }
+
+const struct solver day24_solver = {
+	.name = "day24",
+	.parse = day24_parse,
+	.free = day24_free,
+	.part1 = day24_part1,
+	.part2 = day24_part2,
+};
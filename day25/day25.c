@@ -2,6 +2,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "input.h"
+#include "solver.h"
+
 struct point
 {
 	int v[4];
@@ -35,8 +38,16 @@ static struct sky *sky_load(FILE *input)
 		return NULL;
 	}
 
+	struct input in;
+	if (input_map(&in, input) < 0)
+	{
+		sky_free(s);
+		return NULL;
+	}
+
 	struct point pt = {0};
-	while (fscanf(input, " %d,%d,%d,%d", pt.v+0,pt.v+1,pt.v+2,pt.v+3) == 4)
+	while (input_next_int(&in, pt.v+0) && input_next_int(&in, pt.v+1) &&
+	       input_next_int(&in, pt.v+2) && input_next_int(&in, pt.v+3))
 	{
 		if (s->count == s->size)
 		{
@@ -44,6 +55,7 @@ static struct sky *sky_load(FILE *input)
 			struct point *np = realloc(s->p, nsize * sizeof(np[0]));
 			if (!np)
 			{
+				input_unmap(&in);
 				sky_free(s);
 				return NULL;
 			}
@@ -54,6 +66,7 @@ static struct sky *sky_load(FILE *input)
 		pt.rank = 0;
 		s->p[s->count++] = pt;
 	}
+	input_unmap(&in);
 	return s;
 }
 
@@ -133,31 +146,27 @@ static size_t sky_partition(struct sky *s)
 	return count;
 }
 
-int main(int argc, char *argv[])
+static void *day25_parse(FILE *input)
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
-
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
-	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
-	}
+	return sky_load(input);
+}
 
-	struct sky *s = sky_load(input);
-	fclose(input);
-	if (!s)
-	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
-	}
+static void day25_free(void *data)
+{
+	sky_free(data);
+}
 
-	sky_partition(s);
-	printf("Part1: %zu\n", sky_partition(s));
-	sky_free(s);
+static int day25_part1(void *data, FILE *output)
+{
+	fprintf(output, "%zu", sky_partition(data));
 	return 0;
 }
+
+/* the partition merges the constellations in place */
+const struct solver day25_solver = {
+	.name = "day25",
+	.parse = day25_parse,
+	.free = day25_free,
+	.part1 = day25_part1,
+	.flags = SOLVER_SERIAL,
+};
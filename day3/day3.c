@@ -1,8 +1,15 @@
-#include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "pool.h"
+#include "solver.h"
+
 struct claim
 {
 	int id;			/* identifier */
@@ -10,63 +17,134 @@ struct claim
 	int y;			/* y position */
 	int w;			/* width */
 	int h;			/* height */
+};
+
+struct fabric
+{
+	struct claim *pool;
+	size_t count;
+	int width;		/* right edge of the rightmost claim */
+	int height;		/* bottom edge of the lowest claim */
 
-	struct claim *next;
+	/* grid engine, painted by part1 and read by part2 */
+	int *cell;
+
+	/* prefix engine, summed area of the cells claimed more than once */
+	uint32_t *sat;
+
+	/* sweep and tiled engines, both answers come out of one pass */
+	int swept;
+	uint64_t overlap;
+	int intact;
 };
 
-int fabric[1000][1000];
+/*
+ * An engine computes the area claimed more than once and the first
+ * claim overlapping no other, -1 if there is none. Both return 0 on
+ * success and -1 on error.
+ */
+struct engine
+{
+	const char *name;
+	int (*overlap)(struct fabric *f, uint64_t *area);
+	int (*intact)(struct fabric *f, int *id);
+};
 
-static struct claim *load(FILE *input)
+static struct fabric *load(FILE *input)
 {
-	struct claim *head = NULL;
-	struct claim **tail = &head;
-	struct claim c = {0};
+	struct fabric *f = calloc(1, sizeof(*f));
+	if (!f)
+	{
+		return NULL;
+	}
+	size_t size = 0;
+	struct claim c;
 	while (fscanf(input, " #%d @ %d,%d: %dx%d", &c.id, &c.x, &c.y, &c.w, &c.h) == 5)
 	{
-		struct claim *n = malloc(sizeof(*n));
-		if (!n)
+		if (c.x < 0 || c.y < 0 || c.w < 0 || c.h < 0 ||
+		    c.x > INT32_MAX - c.w || c.y > INT32_MAX - c.h)
 		{
-			break;
+			goto fail;
+		}
+		if (f->count == size)
+		{
+			size_t newsize = size ? size * 2 : 256;
+			struct claim *newpool = realloc(f->pool, newsize * sizeof(newpool[0]));
+			if (!newpool)
+			{
+				goto fail;
+			}
+			f->pool = newpool;
+			size = newsize;
+		}
+		f->pool[f->count++] = c;
+		if (f->width < c.x + c.w)
+		{
+			f->width = c.x + c.w;
+		}
+		if (f->height < c.y + c.h)
+		{
+			f->height = c.y + c.h;
 		}
-		*n = c;
-		*tail = n;
-		tail = &n->next;
 	}
-	return head;
+	if (f->count)
+	{
+		return f;
+	}
+fail:
+	free(f->pool);
+	free(f);
+	return NULL;
 }
 
-static size_t part1(const struct claim *c)
+/* grid: paint every cell of every claim */
+
+static int grid_overlap(struct fabric *f, uint64_t *area)
 {
-	size_t count = 0;
-	memset(fabric, 0, sizeof(fabric));
-	for (; c; c = c->next)
+	free(f->cell);
+	f->cell = calloc((size_t)f->width * f->height, sizeof(f->cell[0]));
+	if (!f->cell)
+	{
+		return -1;
+	}
+	uint64_t count = 0;
+	for (const struct claim *c = f->pool; c < f->pool + f->count; c++)
 	{
 		for (int y = c->y; y < c->y+c->h; y++)
 		{
+			int *row = f->cell + (size_t)y * f->width;
 			for (int x = c->x; x < c->x + c->w; x++)
 			{
-				fabric[y][x]++;
-				if (fabric[y][x] == 2)
+				row[x]++;
+				if (row[x] == 2)
 				{
 					count++;
 				}
 			}
 		}
 	}
-	return count;
+	*area = count;
+	return 0;
 }
 
-static int part2(struct claim *c)
+static int grid_intact(struct fabric *f, int *id)
 {
 	/* part1 is a requisite */
-	for(; c; c = c->next)
+	uint64_t area;
+	if (!f->cell && grid_overlap(f, &area) < 0)
+	{
+		return -1;
+	}
+	*id = -1;
+	for (const struct claim *c = f->pool; c < f->pool + f->count; c++)
 	{
 		int found = 1;
 		for (int y = c->y; found && y < c->y+c->h; y++)
 		{
+			const int *row = f->cell + (size_t)y * f->width;
 			for (int x = c->x; found && x < c->x+c->w; x++)
 			{
-				if (fabric[y][x] > 1)
+				if (row[x] > 1)
 				{
 					found = 0;
 				}
@@ -74,42 +152,722 @@ static int part2(struct claim *c)
 		}
 		if (found)
 		{
-			return c->id;
+			*id = c->id;
+			break;
 		}
 	}
-	return -1;
+	return 0;
 }
 
-int main(int argc, char *argv[])
+/*
+ * prefix: every claim adds 1 at its top left corner, subtracts 1 at the
+ * top right and bottom left ones and adds 1 at the bottom right one of
+ * a difference grid. One pass of prefix sums turns the differences into
+ * the number of claims of every cell, 16 bits are enough since the
+ * sums are modulo 2^16 and a cell holds fewer claims than that. The
+ * same pass builds the summed area table of the cells claimed more
+ * than once, so that a claim is checked with four lookups.
+ */
+
+#define SAT(f, x, y) (f)->sat[(size_t)(y) * ((f)->width + 1) + (x)]
+
+static int prefix_build(struct fabric *f)
 {
-	if (argc < 2)
+	if (f->count > UINT16_MAX)
+	{
+		return -1;
+	}
+	size_t width = (size_t)f->width + 1;
+	size_t height = (size_t)f->height + 1;
+	uint16_t *diff = calloc(width * height, sizeof(diff[0]));
+	f->sat = malloc(width * height * sizeof(f->sat[0]));
+	if (!diff || !f->sat)
+	{
+		free(f->sat);
+		f->sat = NULL;
+		free(diff);
+		return -1;
+	}
+	for (const struct claim *c = f->pool; c < f->pool + f->count; c++)
 	{
-		fprintf(stderr, "Usage: %s filename\n", argv[0]);
-		return 1;
+		uint16_t *top = diff + (size_t)c->y * width;
+		uint16_t *bottom = diff + (size_t)(c->y + c->h) * width;
+		top[c->x]++;
+		top[c->x + c->w]--;
+		bottom[c->x]--;
+		bottom[c->x + c->w]++;
 	}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+	/* each row of diff becomes the claim counts of its cells */
+	memset(f->sat, 0, width * sizeof(f->sat[0]));
+	for (size_t y = 0; y + 1 < height; y++)
 	{
-		fprintf(stderr, "File %s not found\n", argv[1]);
-		return 1;
+		uint16_t *row = diff + y * width;
+		const uint16_t *above = y ? row - width : NULL;
+		const uint32_t *sabove = f->sat + y * width;
+		uint32_t *srow = f->sat + (y + 1) * width;
+		uint16_t run = 0;
+		uint32_t twice = 0;
+		srow[0] = 0;
+		for (size_t x = 0; x + 1 < width; x++)
+		{
+			run += row[x];
+			row[x] = run + (above ? above[x] : 0);
+			twice += row[x] > 1;
+			srow[x + 1] = sabove[x + 1] + twice;
+		}
 	}
+	free(diff);
+	return 0;
+}
 
-	struct claim *lst = load(input);
-	fclose(input);
-	if (!lst)
+static int prefix_overlap(struct fabric *f, uint64_t *area)
+{
+	if (!f->sat && prefix_build(f) < 0)
 	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		return -1;
 	}
+	*area = SAT(f, f->width, f->height);
+	return 0;
+}
 
-	printf("Part1: %zu\n", part1(lst));
-	printf("Part2: %d\n", part2(lst));
-	while (lst)
+static int prefix_intact(struct fabric *f, int *id)
+{
+	if (!f->sat && prefix_build(f) < 0)
 	{
-		struct claim *tmp = lst;
-		lst = lst->next;
-		free(tmp);
+		return -1;
+	}
+	*id = -1;
+	for (const struct claim *c = f->pool; c < f->pool + f->count; c++)
+	{
+		int x1 = c->x + c->w, y1 = c->y + c->h;
+		uint32_t twice = SAT(f, x1, y1) - SAT(f, c->x, y1) -
+			SAT(f, x1, c->y) + SAT(f, c->x, c->y);
+		if (twice == 0)
+		{
+			*id = c->id;
+			break;
+		}
 	}
 	return 0;
 }
+
+/*
+ * sweep: walk the top and bottom edges of the claims in y order and
+ * keep the claims crossing the sweep line in a segment tree over the
+ * distinct x edges. Every node knows how many claims cover it whole,
+ * the length below it covered once and twice, and the highest cover
+ * below it. The area covered twice between two edges is the length
+ * covered twice at the root times the distance between the edges.
+ *
+ * A claim overlaps an earlier claim if the highest cover of its x
+ * range is not zero when it is added. It overlaps a later claim if one
+ * was added over its x range before it is removed: every claim stamps
+ * its x range with its rank when added, and the highest stamp of the
+ * range is compared with the claim's own when the claim is removed.
+ * Nothing depends on the range of the coordinates.
+ */
+
+struct node
+{
+	int cover;		/* claims covering the whole node */
+	int max;		/* highest cover of a point below */
+	int64_t once;		/* length covered at least once */
+	int64_t twice;		/* length covered at least twice */
+	size_t stamp;		/* highest rank stamped over the whole node */
+	size_t maxstamp;	/* highest rank stamped over a point below */
+};
+
+struct tree
+{
+	struct node *node;
+	const int *xs;		/* leaf i spans [xs[i], xs[i + 1]) */
+	size_t leaves;
+};
+
+struct event
+{
+	int y;
+	int add;		/* 0 for the bottom edge, 1 for the top */
+	size_t claim;
+};
+
+static int int_cmp(const void *a, const void *b)
+{
+	int ia = *(const int *)a;
+	int ib = *(const int *)b;
+	return (ia > ib) - (ia < ib);
+}
+
+/* by y, bottom edges first since claims are half open, then by claim */
+static int event_cmp(const void *a, const void *b)
+{
+	const struct event *ea = a;
+	const struct event *eb = b;
+	if (ea->y != eb->y)
+	{
+		return (ea->y > eb->y) - (ea->y < eb->y);
+	}
+	if (ea->add != eb->add)
+	{
+		return ea->add - eb->add;
+	}
+	return (ea->claim > eb->claim) - (ea->claim < eb->claim);
+}
+
+static size_t leaf_of(const struct tree *t, int x)
+{
+	size_t lo = 0, hi = t->leaves;
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		if (t->xs[mid] < x)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static void tree_pull(struct tree *t, size_t n, size_t lo, size_t hi)
+{
+	struct node *p = t->node + n;
+	int64_t once = 0, twice = 0;
+	int max = 0;
+	size_t maxstamp = 0;
+	if (hi - lo > 1)
+	{
+		const struct node *l = t->node + 2 * n;
+		const struct node *r = l + 1;
+		once = l->once + r->once;
+		twice = l->twice + r->twice;
+		max = l->max > r->max ? l->max : r->max;
+		maxstamp = l->maxstamp > r->maxstamp ? l->maxstamp : r->maxstamp;
+	}
+	int64_t full = t->xs[hi] - t->xs[lo];
+	p->once = p->cover >= 1 ? full : once;
+	p->twice = p->cover >= 2 ? full : p->cover == 1 ? once : twice;
+	p->max = p->cover + max;
+	p->maxstamp = p->stamp > maxstamp ? p->stamp : maxstamp;
+}
+
+/* add delta to the cover of [a, b) and stamp it with rank if not 0 */
+static void tree_update(struct tree *t, size_t n, size_t lo, size_t hi,
+			size_t a, size_t b, int delta, size_t rank)
+{
+	if (b <= lo || hi <= a)
+	{
+		return;
+	}
+	if (a <= lo && hi <= b)
+	{
+		t->node[n].cover += delta;
+		if (t->node[n].stamp < rank)
+		{
+			t->node[n].stamp = rank;
+		}
+	}
+	else
+	{
+		size_t mid = (lo + hi) / 2;
+		tree_update(t, 2 * n, lo, mid, a, b, delta, rank);
+		tree_update(t, 2 * n + 1, mid, hi, a, b, delta, rank);
+	}
+	tree_pull(t, n, lo, hi);
+}
+
+/* highest cover and stamp of [a, b), adding the nodes above on the way */
+static void tree_query(const struct tree *t, size_t n, size_t lo, size_t hi,
+		       size_t a, size_t b, int above, size_t stamped,
+		       int *max, size_t *maxstamp)
+{
+	if (b <= lo || hi <= a)
+	{
+		return;
+	}
+	const struct node *p = t->node + n;
+	if (a <= lo && hi <= b)
+	{
+		if (*max < above + p->max)
+		{
+			*max = above + p->max;
+		}
+		size_t s = stamped > p->maxstamp ? stamped : p->maxstamp;
+		if (*maxstamp < s)
+		{
+			*maxstamp = s;
+		}
+		return;
+	}
+	above += p->cover;
+	stamped = stamped > p->stamp ? stamped : p->stamp;
+	size_t mid = (lo + hi) / 2;
+	tree_query(t, 2 * n, lo, mid, a, b, above, stamped, max, maxstamp);
+	tree_query(t, 2 * n + 1, mid, hi, a, b, above, stamped, max, maxstamp);
+}
+
+static int sweep(struct fabric *f)
+{
+	size_t n = f->count;
+	int *xs = malloc(2 * n * sizeof(xs[0]));
+	struct event *events = malloc(2 * n * sizeof(events[0]));
+	size_t *rank = malloc(n * sizeof(rank[0]));
+	char *overlapped = calloc(n, sizeof(overlapped[0]));
+	struct tree t = { .xs = xs };
+	if (xs && events && rank && overlapped)
+	{
+		size_t nx = 0, ne = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			const struct claim *c = f->pool + i;
+			if (c->w == 0 || c->h == 0)
+			{
+				continue;
+			}
+			xs[nx++] = c->x;
+			xs[nx++] = c->x + c->w;
+			events[ne++] = (struct event){ c->y, 1, i };
+			events[ne++] = (struct event){ c->y + c->h, 0, i };
+		}
+		qsort(xs, nx, sizeof(xs[0]), int_cmp);
+		size_t unique = 0;
+		for (size_t i = 0; i < nx; i++)
+		{
+			if (unique == 0 || xs[unique - 1] != xs[i])
+			{
+				xs[unique++] = xs[i];
+			}
+		}
+		t.leaves = unique > 1 ? unique - 1 : 1;
+		t.node = calloc(4 * t.leaves, sizeof(t.node[0]));
+		qsort(events, ne, sizeof(events[0]), event_cmp);
+
+		uint64_t area = 0;
+		size_t ranks = 0;
+		for (size_t i = 0; t.node && i < ne; i++)
+		{
+			if (i > 0)
+			{
+				area += (uint64_t)t.node[1].twice * (events[i].y - events[i - 1].y);
+			}
+			const struct claim *c = f->pool + events[i].claim;
+			size_t a = leaf_of(&t, c->x);
+			size_t b = leaf_of(&t, c->x + c->w);
+			int max = 0;
+			size_t maxstamp = 0;
+			tree_query(&t, 1, 0, t.leaves, a, b, 0, 0, &max, &maxstamp);
+			if (events[i].add)
+			{
+				/* overlaps an earlier claim */
+				overlapped[events[i].claim] |= max > 0;
+				rank[events[i].claim] = ++ranks;
+				tree_update(&t, 1, 0, t.leaves, a, b, 1, ranks);
+			}
+			else
+			{
+				/* a later claim was added over it */
+				overlapped[events[i].claim] |= maxstamp > rank[events[i].claim];
+				tree_update(&t, 1, 0, t.leaves, a, b, -1, 0);
+			}
+		}
+		if (t.node)
+		{
+			f->overlap = area;
+			f->intact = -1;
+			for (size_t i = 0; i < n; i++)
+			{
+				if (!overlapped[i])
+				{
+					f->intact = f->pool[i].id;
+					break;
+				}
+			}
+			f->swept = 1;
+		}
+	}
+	free(t.node);
+	free(overlapped);
+	free(rank);
+	free(events);
+	free(xs);
+	return f->swept ? 0 : -1;
+}
+
+static int sweep_overlap(struct fabric *f, uint64_t *area)
+{
+	if (!f->swept && sweep(f) < 0)
+	{
+		return -1;
+	}
+	*area = f->overlap;
+	return 0;
+}
+
+static int sweep_intact(struct fabric *f, int *id)
+{
+	if (!f->swept && sweep(f) < 0)
+	{
+		return -1;
+	}
+	*id = f->intact;
+	return 0;
+}
+
+/*
+ * tiled: the fabric is cut into tiles that fit in the L1 cache and
+ * every claim is binned to the tiles it touches. Each tile is then
+ * painted on its own, by one worker of the pool, in a scratch buffer
+ * of that worker with counters saturating at 2, 16 cells at a time.
+ * The worker counts the cells of the tile claimed twice and marks the
+ * claims of the bin that hit one. No cell is shared between workers,
+ * so only the marks need an atomic store. The pool is the one the part
+ * runs on, if any, or one of -j threads, and is only used with more
+ * tiles than workers.
+ */
+
+#define TILE 128
+
+struct tiles
+{
+	struct fabric *f;
+	struct pool *pool;
+	size_t cols;
+	size_t rows;
+	size_t *start;		/* claims of tile i in bin[start[i], start[i + 1]) */
+	uint32_t *bin;
+	uint8_t *scratch;	/* TILE * TILE per worker, and one for outside */
+	uint64_t *area;		/* cells claimed twice per tile */
+	char *overlapped;
+	size_t left;		/* tiles not painted */
+};
+
+struct tile_job
+{
+	struct tiles *t;
+	size_t tile;
+};
+
+/* tiles covered by the claim, last ones included */
+static void tile_span(const struct claim *c, size_t *x0, size_t *y0, size_t *x1, size_t *y1)
+{
+	*x0 = c->x / TILE;
+	*y0 = c->y / TILE;
+	*x1 = (c->x + c->w - 1) / TILE;
+	*y1 = (c->y + c->h - 1) / TILE;
+}
+
+static void tile_paint(void *arg)
+{
+	const struct tile_job *j = arg;
+	struct tiles *t = j->t;
+	const struct fabric *f = t->f;
+	int worker = t->pool ? pool_worker(t->pool) : -1;
+	uint8_t *cell = t->scratch + (size_t)(worker + 1) * TILE * TILE;
+	int tx = j->tile % t->cols * TILE;
+	int ty = j->tile / t->cols * TILE;
+
+	memset(cell, 0, TILE * TILE);
+	for (size_t i = t->start[j->tile]; i < t->start[j->tile + 1]; i++)
+	{
+		const struct claim *c = f->pool + t->bin[i];
+		int x0 = c->x > tx ? c->x - tx : 0;
+		int y0 = c->y > ty ? c->y - ty : 0;
+		int x1 = c->x + c->w - tx < TILE ? c->x + c->w - tx : TILE;
+		int y1 = c->y + c->h - ty < TILE ? c->y + c->h - ty : TILE;
+		for (int y = y0; y < y1; y++)
+		{
+			uint8_t *row = cell + y * TILE;
+			int x = x0;
+#ifdef __SSE2__
+			const __m128i one = _mm_set1_epi8(1);
+			const __m128i two = _mm_set1_epi8(2);
+			for (; x + 16 <= x1; x += 16)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i *)(row + x));
+				v = _mm_min_epu8(_mm_add_epi8(v, one), two);
+				_mm_storeu_si128((__m128i *)(row + x), v);
+			}
+#endif
+			for (; x < x1; x++)
+			{
+				row[x] += row[x] < 2;
+			}
+		}
+	}
+	uint64_t area = 0;
+	for (int i = 0; i < TILE * TILE; i++)
+	{
+		area += cell[i] == 2;
+	}
+	t->area[j->tile] = area;
+
+	for (size_t i = t->start[j->tile]; i < t->start[j->tile + 1]; i++)
+	{
+		const struct claim *c = f->pool + t->bin[i];
+		int x0 = c->x > tx ? c->x - tx : 0;
+		int y0 = c->y > ty ? c->y - ty : 0;
+		int x1 = c->x + c->w - tx < TILE ? c->x + c->w - tx : TILE;
+		int y1 = c->y + c->h - ty < TILE ? c->y + c->h - ty : TILE;
+		int twice = 0;
+		for (int y = y0; !twice && y < y1; y++)
+		{
+			const uint8_t *row = cell + y * TILE;
+			int x = x0;
+#ifdef __SSE2__
+			__m128i max = _mm_setzero_si128();
+			for (; x + 16 <= x1; x += 16)
+			{
+				max = _mm_max_epu8(max, _mm_loadu_si128((const __m128i *)(row + x)));
+			}
+			twice = _mm_movemask_epi8(_mm_cmpeq_epi8(max, _mm_set1_epi8(2))) != 0;
+#endif
+			for (; x < x1; x++)
+			{
+				twice |= row[x] > 1;
+			}
+		}
+		if (twice)
+		{
+			__atomic_store_n(t->overlapped + t->bin[i], 1, __ATOMIC_RELAXED);
+		}
+	}
+	__atomic_sub_fetch(&t->left, 1, __ATOMIC_RELEASE);
+}
+
+/* -j threads painting the tiles outside of a pool, serial by default */
+static size_t threads = 1;
+
+static int tiled(struct fabric *f)
+{
+	struct tiles t = { .f = f };
+	t.cols = (f->width + TILE - 1) / TILE;
+	t.rows = (f->height + TILE - 1) / TILE;
+	size_t count = t.cols * t.rows;
+	t.start = calloc(count + 1, sizeof(t.start[0]));
+	t.area = malloc(count * sizeof(t.area[0]));
+	t.overlapped = calloc(f->count, sizeof(t.overlapped[0]));
+	struct tile_job *jobs = malloc(count * sizeof(jobs[0]));
+	if (!t.start || !t.area || !t.overlapped || !jobs)
+	{
+		goto out;
+	}
+
+	/* count, then fill the bins */
+	size_t x0, y0, x1, y1;
+	for (const struct claim *c = f->pool; c < f->pool + f->count; c++)
+	{
+		if (c->w > 0 && c->h > 0)
+		{
+			tile_span(c, &x0, &y0, &x1, &y1);
+			for (size_t y = y0; y <= y1; y++)
+			{
+				for (size_t x = x0; x <= x1; x++)
+				{
+					t.start[y * t.cols + x + 1]++;
+				}
+			}
+		}
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		t.start[i + 1] += t.start[i];
+	}
+	t.bin = malloc(t.start[count] * sizeof(t.bin[0]));
+	if (!t.bin)
+	{
+		goto out;
+	}
+	for (const struct claim *c = f->pool; c < f->pool + f->count; c++)
+	{
+		if (c->w > 0 && c->h > 0)
+		{
+			tile_span(c, &x0, &y0, &x1, &y1);
+			for (size_t y = y0; y <= y1; y++)
+			{
+				for (size_t x = x0; x <= x1; x++)
+				{
+					t.bin[t.start[y * t.cols + x]++] = c - f->pool;
+				}
+			}
+		}
+	}
+	/* filling moved every start to the next one */
+	memmove(t.start + 1, t.start, count * sizeof(t.start[0]));
+	t.start[0] = 0;
+
+	struct pool *own = NULL;
+	t.pool = pool_current();
+	if (!t.pool && threads != 1 && count > threads)
+	{
+		t.pool = own = pool_new(threads);
+	}
+	if (t.pool && count <= pool_size(t.pool))
+	{
+		t.pool = NULL;
+	}
+	size_t workers = t.pool ? pool_size(t.pool) : 0;
+	t.scratch = malloc((workers + 1) * TILE * TILE);
+	if (!t.scratch)
+	{
+		pool_free(own);
+		goto out;
+	}
+	t.left = count;
+	for (size_t i = 0; i < count; i++)
+	{
+		jobs[i] = (struct tile_job){ &t, i };
+		if (!t.pool || pool_submit(t.pool, tile_paint, jobs + i) < 0)
+		{
+			tile_paint(jobs + i);
+		}
+	}
+	if (t.pool)
+	{
+		pool_help(t.pool, &t.left);
+	}
+	pool_free(own);
+
+	f->overlap = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		f->overlap += t.area[i];
+	}
+	f->intact = -1;
+	for (size_t i = 0; i < f->count; i++)
+	{
+		if (!t.overlapped[i])
+		{
+			f->intact = f->pool[i].id;
+			break;
+		}
+	}
+	f->swept = 1;
+out:
+	if (!f->swept)
+	{
+		fprintf(stderr, "Cannot allocate the tiles\n");
+	}
+	free(t.scratch);
+	free(jobs);
+	free(t.bin);
+	free(t.overlapped);
+	free(t.area);
+	free(t.start);
+	return f->swept ? 0 : -1;
+}
+
+static int tiled_overlap(struct fabric *f, uint64_t *area)
+{
+	if (!f->swept && tiled(f) < 0)
+	{
+		return -1;
+	}
+	*area = f->overlap;
+	return 0;
+}
+
+static int tiled_intact(struct fabric *f, int *id)
+{
+	if (!f->swept && tiled(f) < 0)
+	{
+		return -1;
+	}
+	*id = f->intact;
+	return 0;
+}
+
+static const struct engine engines[] = {
+	{ "grid", grid_overlap, grid_intact },
+	{ "prefix", prefix_overlap, prefix_intact },
+	{ "sweep", sweep_overlap, sweep_intact },
+	{ "tiled", tiled_overlap, tiled_intact },
+};
+
+/* engine picked with -e, by default prefix sums unless the grid is too large */
+static const struct engine *engine;
+
+#define GRID_CELLS (1 << 24)
+
+static const struct engine *engine_for(const struct fabric *f)
+{
+	if (engine)
+	{
+		return engine;
+	}
+	if ((uint64_t)f->width * f->height <= GRID_CELLS && f->count <= UINT16_MAX)
+	{
+		return engines + 1;
+	}
+	return engines + 2;
+}
+
+static int day3_option(int opt, const char *arg)
+{
+	if (opt == 'j')
+	{
+		long n = strtol(arg, NULL, 10);
+		threads = n > 0 ? n : 0;
+		return n > 0 ? 0 : -1;
+	}
+	for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+	{
+		if (!strcmp(arg, engines[i].name))
+		{
+			engine = engines + i;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static void *day3_parse(FILE *input)
+{
+	return load(input);
+}
+
+static void day3_free(void *data)
+{
+	struct fabric *f = data;
+	free(f->sat);
+	free(f->cell);
+	free(f->pool);
+	free(f);
+}
+
+static int day3_part1(void *data, FILE *output)
+{
+	uint64_t area;
+	if (engine_for(data)->overlap(data, &area) < 0)
+	{
+		return -1;
+	}
+	fprintf(output, "%llu", (unsigned long long)area);
+	return 0;
+}
+
+static int day3_part2(void *data, FILE *output)
+{
+	int id;
+	if (engine_for(data)->intact(data, &id) < 0)
+	{
+		return -1;
+	}
+	fprintf(output, "%d", id);
+	return 0;
+}
+
+const struct solver day3_solver = {
+	.name = "day3",
+	.options = "e:j:",
+	.usage = "[-e grid|prefix|sweep|tiled] [-j threads]",
+	.option = day3_option,
+	.parse = day3_parse,
+	.free = day3_free,
+	.part1 = day3_part1,
+	.part2 = day3_part2,
+	.flags = SOLVER_SERIAL,
+};
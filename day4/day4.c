@@ -1,271 +1,397 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-struct event
-{
-	int year;
-	int month;
-	int day;
-
-	int hour;
-	int minute;
+#include "input.h"
+#include "solver.h"
 
-	int id;
+enum { BEGINS_SHIFT, FALLS_ASLEEP, WAKES_UP };
 
-	enum { BEGINS_SHIFT, FALLS_ASLEEP, WAKES_UP } type;
-};
+/*
+ * Guards by slot, in order of first appearance. A slot never moves, the
+ * arrays only grow, and the 60 minute counters of a slot are contiguous
+ * so that the per-guard max and argmax run over one short array. The
+ * ids map to slots through an open addressing index.
+ *
+ * While the log is walked the counters hold differences, +1 where a nap
+ * starts and -1 where it ends, and tot_asleep is kept as the naps come.
+ */
+#define MINUTES 60
 
-struct guard
+struct guards
 {
-	int id;
-	int minutes[60];
+	size_t count;
+	size_t size;
+	int *id;
+	int *minutes;		/* MINUTES counters per slot */
+	int *tot_asleep;
+	int *max_asleep;
+	int *max_asleep_minute;	/* -1 if never asleep */
 
-	int tot_asleep;
-	int max_asleep;
-	int max_asleep_minute;
+	uint32_t *index;	/* slot + 1 by hash of the id, 0 if empty */
+	size_t mask;
 };
 
-struct guard_array
+static void guards_free(struct guards *g)
 {
-	struct guard *pool;
-	size_t count;
-	size_t size;
-};
+	free(g->index);
+	free(g->max_asleep_minute);
+	free(g->max_asleep);
+	free(g->tot_asleep);
+	free(g->minutes);
+	free(g->id);
+}
 
-static int find_guard(struct guard_array *a, int guard_id, size_t *pos)
+static size_t guard_hash(int id)
 {
-	if (a->count == 0)
+	uint32_t h = id;
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	return h;
+}
+
+static int guards_grow(struct guards *g)
+{
+	size_t size = g->size ? g->size * 2 : 64;
+	int *id = realloc(g->id, size * sizeof(id[0]));
+	if (id)
 	{
-		if (pos)
-		{
-			*pos = 0;
-		}
-		return 0;
+		g->id = id;
 	}
-
-	size_t low = 0;
-	size_t high = a->count;
-	while (low < high)
+	int *minutes = realloc(g->minutes, size * MINUTES * sizeof(minutes[0]));
+	if (minutes)
 	{
-		int mid = low + (high - low) / 2;
-		if (a->pool[mid].id < guard_id)
-		{
-			low = mid + 1;
-		}
-		else
-		{
-			high = mid;
-		}
+		g->minutes = minutes;
 	}
-
-	if (pos)
+	int *tot_asleep = realloc(g->tot_asleep, size * sizeof(tot_asleep[0]));
+	if (tot_asleep)
 	{
-		*pos = low;
+		g->tot_asleep = tot_asleep;
+	}
+	if (!id || !minutes || !tot_asleep)
+	{
+		return -1;
 	}
 
-	return guard_id == a->pool[low].id;
+	/* the index keeps a load of at most one half */
+	uint32_t *index = calloc(2 * size, sizeof(index[0]));
+	if (!index)
+	{
+		return -1;
+	}
+	size_t mask = 2 * size - 1;
+	for (size_t s = 0; s < g->count; s++)
+	{
+		size_t i = guard_hash(g->id[s]) & mask;
+		while (index[i])
+		{
+			i = (i + 1) & mask;
+		}
+		index[i] = s + 1;
+	}
+	free(g->index);
+	g->index = index;
+	g->mask = mask;
+	g->size = size;
+	return 0;
 }
 
-static int add_guard(struct guard_array *a, int guard_id)
+/* slot of the guard, added if new, -1 on error */
+static long guard_slot(struct guards *g, int guard_id)
 {
-	size_t pos;
-	if (find_guard(a, guard_id, &pos))
+	if (g->count == g->size && guards_grow(g) < 0)
 	{
 		return -1;
 	}
+	size_t i = guard_hash(guard_id) & g->mask;
+	for (; g->index[i]; i = (i + 1) & g->mask)
+	{
+		if (g->id[g->index[i] - 1] == guard_id)
+		{
+			return g->index[i] - 1;
+		}
+	}
+	size_t s = g->count++;
+	g->index[i] = s + 1;
+	g->id[s] = guard_id;
+	memset(g->minutes + s * MINUTES, 0, MINUTES * sizeof(g->minutes[0]));
+	g->tot_asleep[s] = 0;
+	return s;
+}
+
+/*
+ * Every line becomes one 64-bit key: the timestamp packed in the high
+ * 32 bits so that the keys sort by time, the event in the low ones.
+ */
+#define EVENT_TYPE(key) ((int)((key) >> 30 & 3))
+#define EVENT_ID(key) ((int)((key) & 0x3fffffff))
+#define EVENT_MINUTE(key) ((int)((key) >> 32 & 63))
 
-	if (a->count == a->size)
+/* n decimal digits at s, -1 if one is not a digit */
+static int digits(const char *s, int n)
+{
+	int v = 0;
+	for (int i = 0; i < n; i++)
 	{
-		size_t newsize = a->size ? a->size * 2 : 2;
-		struct guard *newpool = realloc(a->pool, newsize * sizeof(*newpool));
-		if (newpool == NULL)
+		unsigned d = (unsigned char)s[i] - '0';
+		if (d > 9)
 		{
 			return -1;
 		}
-		a->pool = newpool;
-		a->size = newsize;
+		v = v * 10 + d;
 	}
-
-	memmove(a->pool + pos + 1, a->pool + pos, sizeof(a->pool[0]) * (a->count-pos));
-	memset(&a->pool[pos], 0, sizeof(a->pool[0]));
-	a->pool[pos].id = guard_id;
-	a->count++;
-	return pos;
+	return v;
 }
 
-static int parse_event(const char *line, struct event *t)
+/* "[yyyy-mm-dd hh:mm] " then the event, the line without its \n */
+static int parse_event(const char *line, size_t len, uint64_t *key)
 {
-	if (sscanf(line,
-		   "[%d-%d-%d %d:%d] Guard #%d begins shift\n",
-		   &t->year, &t->month, &t->day, &t->hour, &t->minute, &t->id) == 6)
+	if (len < 19 || line[0] != '[' || line[5] != '-' || line[8] != '-' ||
+	    line[11] != ' ' || line[14] != ':' || line[17] != ']')
+	{
+		return -1;
+	}
+	int year = digits(line + 1, 4);
+	int month = digits(line + 6, 2);
+	int day = digits(line + 9, 2);
+	int hour = digits(line + 12, 2);
+	int minute = digits(line + 15, 2);
+	/* each field has to fit its bits of the key */
+	if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 ||
+	    hour < 0 || hour > 23 || minute < 0 || minute > 59)
 	{
-		t->type = BEGINS_SHIFT;
+		return -1;
 	}
-	else if (strcmp(line+19, "wakes up\n") == 0)
+	uint64_t time = (uint64_t)year << 20 | month << 16 | day << 11 | hour << 6 | minute;
+
+	const char *text = line + 19;
+	size_t tlen = len - 19;
+	uint64_t event;
+	if (tlen > 7 && !memcmp(text, "Guard #", 7))
 	{
-		t->id = -1;
-		t->type = WAKES_UP;
+		int id = 0;
+		size_t i = 7;
+		for (; i < tlen && text[i] >= '0' && text[i] <= '9' && id < 0x3fffffff / 10; i++)
+		{
+			id = id * 10 + text[i] - '0';
+		}
+		if (i == 7 || i + 13 != tlen || memcmp(text + i, " begins shift", 13))
+		{
+			return -1;
+		}
+		event = (uint64_t)BEGINS_SHIFT << 30 | id;
+	}
+	else if (tlen == 8 && !memcmp(text, "wakes up", 8))
+	{
+		event = (uint64_t)WAKES_UP << 30;
 	}
-	else if (strcmp(line+19, "falls asleep\n") == 0)
+	else if (tlen == 12 && !memcmp(text, "falls asleep", 12))
 	{
-		t->id = -1;
-		t->type = FALLS_ASLEEP;
+		event = (uint64_t)FALLS_ASLEEP << 30;
 	}
 	else
 	{
 		return -1;
 	}
+	*key = time << 32 | event;
 	return 0;
 }
 
-static int event_cmp(const void *d1, const void *d2)
+/*
+ * Stable LSD radix sort of the keys on the bytes of the timestamp,
+ * skipping the bytes that are the same in every key.
+ */
+static int sort_events(uint64_t *keys, size_t count)
 {
-	const struct event *a = d1;
-	const struct event *b = d2;
-	if (a->year != b->year)
-		return a->year - b->year;
-	if (a->month != b->month)
-		return a->month - b->month;
-	if (a->day != b->day)
-		return a->day - b->day;
-	if (a->hour != b->hour)
-		return a->hour - b->hour;
-	return a->minute - b->minute;
+	uint64_t *tmp = malloc(count * sizeof(tmp[0]));
+	if (!tmp)
+	{
+		return -1;
+	}
+	uint64_t *src = keys, *dst = tmp;
+	for (int shift = 32; shift < 64; shift += 8)
+	{
+		size_t bucket[257] = {0};
+		for (size_t i = 0; i < count; i++)
+		{
+			bucket[(src[i] >> shift & 0xff) + 1]++;
+		}
+		if (bucket[(src[0] >> shift & 0xff) + 1] == count)
+		{
+			continue;
+		}
+		for (int b = 0; b < 256; b++)
+		{
+			bucket[b + 1] += bucket[b];
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			dst[bucket[src[i] >> shift & 0xff]++] = src[i];
+		}
+		uint64_t *t = src;
+		src = dst;
+		dst = t;
+	}
+	if (src != keys)
+	{
+		memcpy(keys, src, count * sizeof(keys[0]));
+	}
+	free(tmp);
+	return 0;
 }
 
-static int parse_guards(FILE *input, struct guard_array *ga)
+static int parse_guards(FILE *input, struct guards *g)
 {
-	struct event *events = NULL;
+	memset(g, 0, sizeof(*g));
+	struct input in;
+	if (input_map(&in, input) < 0)
+	{
+		return -1;
+	}
+
+	/* a line takes 27 bytes at least */
+	size_t size = (in.end - in.data) / 27 + 1;
+	uint64_t *events = malloc(size * sizeof(events[0]));
 	size_t count = 0;
-	size_t size = 0;
-	char *line = NULL;
-	size_t sline = 0;
-	while (getline(&line, &sline, input) != -1)
+	for (const char *p = in.data; events && p < in.end; )
 	{
-		struct event e;
-		if (parse_event(line, &e) < 0)
+		const char *eol = memchr(p, '\n', in.end - p);
+		size_t len = (eol ? eol : in.end) - p;
+		if (len > 0 && p[len - 1] == '\r')
 		{
-			break;
+			len--;
 		}
-		else if (count == size)
+		if (count == size || parse_event(p, len, events + count) < 0)
 		{
-			size_t newsize = size ? size * 2 : 8;
-			struct event *newevents = realloc(events, newsize * sizeof(*newevents));
-			if (!newevents)
-			{
-				break;
-			}
-			size = newsize;
-			events = newevents;
+			break;
 		}
-		events[count] = e;
 		count++;
+		p = eol ? eol + 1 : in.end;
+	}
+	input_unmap(&in);
+	if (!events || (count && sort_events(events, count) < 0))
+	{
+		free(events);
+		return -1;
 	}
-	free(line);
-	qsort(events, count, sizeof(events[0]), event_cmp);
 
 	/* fill the asleep schedule for each guard */
-	memset(ga, 0, sizeof(*ga));
-	int guard = -1;
-	struct event *last = NULL;
-	for (struct event *e = events; e < events + count; e++)
+	long slot = -1;
+	int asleep = -1;
+	for (const uint64_t *e = events; e < events + count; e++)
 	{
-		size_t pos;
-		switch (e->type) {
+		switch (EVENT_TYPE(*e)) {
 		case BEGINS_SHIFT:
-			guard = e->id;
-			add_guard(ga, guard);
-			last = NULL;
+			slot = guard_slot(g, EVENT_ID(*e));
+			if (slot < 0)
+			{
+				free(events);
+				return -1;
+			}
+			asleep = -1;
 			break;
 
 		case WAKES_UP:
-			if (last)
+			if (asleep >= 0 && slot >= 0 && EVENT_MINUTE(*e) > asleep)
 			{
-				if (find_guard(ga, guard, &pos))
-				{
-					for (int i = last->minute; i < e->minute; i++)
-					{
-						ga->pool[pos].minutes[i]++;
-					}
-				}
+				int *minutes = g->minutes + slot * MINUTES;
+				minutes[asleep]++;
+				minutes[EVENT_MINUTE(*e)]--;
+				g->tot_asleep[slot] += EVENT_MINUTE(*e) - asleep;
 			}
-			last = NULL;
+			asleep = -1;
 			break;
 
 		case FALLS_ASLEEP:
-			last = e;
+			asleep = EVENT_MINUTE(*e);
 			break;
 		}
 	}
 	free(events);
 
-	/* compute the tot_asleep, max_asleep, max_asleep_minute */
-	for (struct guard *g = ga->pool; g < ga->pool + ga->count; g++)
+	/* turn the differences into counts, with max_asleep, max_asleep_minute */
+	g->max_asleep = malloc(g->count * sizeof(g->max_asleep[0]));
+	g->max_asleep_minute = malloc(g->count * sizeof(g->max_asleep_minute[0]));
+	if (!g->max_asleep || !g->max_asleep_minute)
+	{
+		return -1;
+	}
+	for (size_t s = 0; s < g->count; s++)
 	{
-		g->tot_asleep = 0;
-		g->max_asleep = 0;
-		g->max_asleep_minute = -1;
-		for (int i = 0; i < 60; i++)
+		int *minutes = g->minutes + s * MINUTES;
+		int count = 0, max = 0, argmax = -1;
+		for (int i = 0; i < MINUTES; i++)
 		{
-			g->tot_asleep += g->minutes[i];
-			if (g->max_asleep < g->minutes[i])
+			count += minutes[i];
+			minutes[i] = count;
+			if (count > max)
 			{
-				g->max_asleep = g->minutes[i];
-				g->max_asleep_minute = i;
+				max = count;
+				argmax = i;
 			}
 		}
+		g->max_asleep[s] = max;
+		g->max_asleep_minute[s] = argmax;
 	}
 	return 0;
 }
 
-static int guard_totasleep_cmp(const void *d1, const void *d2)
-{
-	const struct guard *a = d1;
-	const struct guard *b = d2;
-	return b->tot_asleep - a->tot_asleep;
-}
-
-static int guard_maxasleep_cmp(const void *d1, const void *d2)
+/* slot of the guard with the highest key, the smallest id on ties */
+static size_t top_guard(const struct guards *g, const int *key)
 {
-	const struct guard *a = d1;
-	const struct guard *b = d2;
-	return b->max_asleep - a->max_asleep;
-}
-
-int main(int argc, char *argv[])
-{
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s filename\n", argv[0]);
-		return 1;
-	}
-
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+	size_t top = 0;
+	for (size_t s = 1; s < g->count; s++)
 	{
-		fprintf(stderr, "File %s not found\n", argv[1]);
-		return 1;
+		if (key[s] > key[top] || (key[s] == key[top] && g->id[s] < g->id[top]))
+		{
+			top = s;
+		}
 	}
+	return top;
+}
 
-	/* parse the guard array from the file */
-	struct guard_array ga;
-	if (parse_guards(input, &ga) < 0)
+static void *day4_parse(FILE *input)
+{
+	struct guards *g = malloc(sizeof(*g));
+	if (g && (parse_guards(input, g) < 0 || g->count == 0))
 	{
-		fclose(input);
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		guards_free(g);
+		free(g);
+		return NULL;
 	}
-	fclose(input);
+	return g;
+}
 
-	/* sort by tot_asleep */
-	qsort(ga.pool, ga.count, sizeof(ga.pool[0]), guard_totasleep_cmp);
-	printf("Part1: %d\n", ga.pool[0].id * ga.pool[0].max_asleep_minute);
+static void day4_free(void *data)
+{
+	guards_free(data);
+	free(data);
+}
 
-	/* sort by max_asleep */
-	qsort(ga.pool, ga.count, sizeof(ga.pool[0]), guard_maxasleep_cmp);
-	printf("Part2: %d\n", ga.pool[0].id * ga.pool[0].max_asleep_minute);
+static int day4_part1(void *data, FILE *output)
+{
+	/* most minutes asleep */
+	const struct guards *g = data;
+	size_t top = top_guard(g, g->tot_asleep);
+	fprintf(output, "%d", g->id[top] * g->max_asleep_minute[top]);
+	return 0;
+}
 
-	free(ga.pool);
+static int day4_part2(void *data, FILE *output)
+{
+	/* most often asleep on the same minute */
+	const struct guards *g = data;
+	size_t top = top_guard(g, g->max_asleep);
+	fprintf(output, "%d", g->id[top] * g->max_asleep_minute[top]);
 	return 0;
 }
+
+const struct solver day4_solver = {
+	.name = "day4",
+	.parse = day4_parse,
+	.free = day4_free,
+	.part1 = day4_part1,
+	.part2 = day4_part2,
+};
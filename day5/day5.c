@@ -1,8 +1,21 @@
 #include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "pool.h"
+#include "solver.h"
+
+/* the tombstone scan, kept to benchmark the kernels against */
 static size_t react(char *str)
 {
 	size_t removed = 0;
@@ -47,70 +60,500 @@ static size_t react(char *str)
 	return len-removed;
 }
 
-static size_t part1(const char *str)
+/* a unit and the same letter in the other case destroy each other */
+static int reacts(char a, char b)
+{
+	return (a ^ b) == 0x20 && (unsigned char)((a | 0x20) - 'a') < 26;
+}
+
+/* push c on the stack buf[0..w) or destroy the top, returns the new w */
+static inline size_t push(char *buf, size_t w, char c)
+{
+	/* store unconditionally, a destroyed unit is overwritten later */
+	int hit = w && reacts(buf[w - 1], c);
+	buf[w] = c;
+	return hit ? w - 1 : w + 1;
+}
+
+/*
+ * Kernels reducing the len units of buf in place in one pass: buf[0..w)
+ * is a stack of the units that survived so far, and every unit either
+ * destroys the top of the stack or is pushed. They return the length
+ * of the reduced polymer left at the start of buf.
+ *
+ * The vector kernels first flag, a block at a time, the units reacting
+ * with the next one. A block with none that does not react with the top
+ * either is pushed whole. Otherwise the flagged pairs that do not
+ * overlap are dropped together, which is fine as the result does not
+ * depend on the order of the reactions, and the rest of the block goes
+ * through push() for the reactions they uncover.
+ */
+struct kernel
+{
+	const char *name;
+	int (*supported)(void);
+	size_t (*reduce)(char *buf, size_t len);
+};
+
+static int always(void)
+{
+	return 1;
+}
+
+static size_t reduce_scalar(char *buf, size_t len)
+{
+	size_t w = 0;
+	for (size_t r = 0; r < len; r++)
+	{
+		w = push(buf, w, buf[r]);
+	}
+	return w;
+}
+
+/* pairs of the mask of reacting pairs that do not overlap, first ones first */
+static uint32_t pairs_pick(uint32_t pairs)
+{
+	uint32_t picked = 0;
+	while (pairs)
+	{
+		uint32_t first = pairs & ~(pairs << 1);
+		picked |= first;
+		pairs &= ~(first | first << 1);
+	}
+	return picked;
+}
+
+/* push the units of block kept by the mask */
+static size_t push_kept(char *buf, size_t w, const char *block, uint32_t keep)
 {
-	char *dup = strdup(str);
-	size_t rv = react(dup);
-	free(dup);
-	return rv;
+	for (; keep; keep &= keep - 1)
+	{
+		w = push(buf, w, block[__builtin_ctz(keep)]);
+	}
+	return w;
 }
 
-static size_t part2(const char *str)
+#ifdef __SSE2__
+/* units of the 16 at p reacting with the next one, the last one left out */
+static uint32_t pairs_sse2(const char *p)
 {
-	char *copy1 = strdup(str);
-	char *copy2 = strdup(str);
+	const __m128i a = _mm_loadu_si128((const __m128i *)p);
+	const __m128i b = _mm_loadu_si128((const __m128i *)(p + 1));
+	const __m128i flipped = _mm_cmpeq_epi8(_mm_xor_si128(a, b), _mm_set1_epi8(0x20));
+	const __m128i index = _mm_sub_epi8(_mm_or_si128(a, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	const __m128i letter = _mm_cmpeq_epi8(_mm_min_epu8(index, _mm_set1_epi8(25)), index);
+	return _mm_movemask_epi8(_mm_and_si128(flipped, letter)) & 0x7fff;
+}
 
-	/* first reduction */
-	size_t minlen = react(copy1);
-	for (int i = 'a'; i <= 'z'; i++)
+static size_t reduce_sse2(char *buf, size_t len)
+{
+	size_t w = 0;
+	size_t r = 0;
+	for (; r + 17 <= len; r += 16)
 	{
-		for (char *src = copy1, *dst = copy2; *src; src++, dst++)
+		uint32_t pairs = pairs_sse2(buf + r);
+		if (!pairs && !(w && reacts(buf[w - 1], buf[r])))
 		{
-			*dst = (tolower(*src) == i) ? '*' : *src;
+			/* w <= r, the block is loaded before it is stored */
+			_mm_storeu_si128((__m128i *)(buf + w), _mm_loadu_si128((const __m128i *)(buf + r)));
+			w += 16;
+			continue;
 		}
-		size_t len = react(copy2);
-		if (minlen > len)
+		uint32_t picked = pairs_pick(pairs);
+		w = push_kept(buf, w, buf + r, ~(picked | picked << 1) & 0xffff);
+	}
+	for (; r < len; r++)
+	{
+		w = push(buf, w, buf[r]);
+	}
+	return w;
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+static int avx2_supported(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("avx2")))
+static uint32_t pairs_avx2(const char *p)
+{
+	const __m256i a = _mm256_loadu_si256((const __m256i *)p);
+	const __m256i b = _mm256_loadu_si256((const __m256i *)(p + 1));
+	const __m256i flipped = _mm256_cmpeq_epi8(_mm256_xor_si256(a, b), _mm256_set1_epi8(0x20));
+	const __m256i index = _mm256_sub_epi8(_mm256_or_si256(a, _mm256_set1_epi8(0x20)),
+					      _mm256_set1_epi8('a'));
+	const __m256i letter = _mm256_cmpeq_epi8(_mm256_min_epu8(index, _mm256_set1_epi8(25)), index);
+	return (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(flipped, letter)) & 0x7fffffff;
+}
+
+__attribute__((target("avx2")))
+static size_t reduce_avx2(char *buf, size_t len)
+{
+	size_t w = 0;
+	size_t r = 0;
+	for (; r + 33 <= len; r += 32)
+	{
+		uint32_t pairs = pairs_avx2(buf + r);
+		if (!pairs && !(w && reacts(buf[w - 1], buf[r])))
 		{
-			minlen = len;
+			/* w <= r, the block is loaded before it is stored */
+			_mm256_storeu_si256((__m256i *)(buf + w),
+					    _mm256_loadu_si256((const __m256i *)(buf + r)));
+			w += 32;
+			continue;
 		}
+		uint32_t picked = pairs_pick(pairs);
+		w = push_kept(buf, w, buf + r, ~(picked | picked << 1));
 	}
-	free(copy2);
-	free(copy1);
-	return minlen;
+	for (; r < len; r++)
+	{
+		w = push(buf, w, buf[r]);
+	}
+	return w;
 }
+#endif
+
+/* fastest first */
+static const struct kernel kernels[] = {
+#if defined(__x86_64__) || defined(__i386__)
+	{ "avx2", avx2_supported, reduce_avx2 },
+#endif
+#ifdef __SSE2__
+	{ "sse2", always, reduce_sse2 },
+#endif
+	{ "scalar", always, reduce_scalar },
+};
+
+#define KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+/* NULL picks the fastest supported kernel, -k forces one */
+static const struct kernel *kernel;
 
-int main(int argc, char *argv[])
+static const struct kernel *kernel_get(void)
 {
-	if (argc < 2)
+	for (size_t i = 0; !kernel && i < KERNELS; i++)
 	{
-		fprintf(stderr, "Usage: %s filename\n", argv[0]);
-		return 1;
+		if (kernels[i].supported())
+		{
+			return kernels + i;
+		}
 	}
+	return kernel;
+}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+/*
+ * Reduce src into dst with the unit, in both cases, taken out first.
+ * Every unit left destroys one unit at most, so once the stack is
+ * longer than *bound by more than the units left the result cannot get
+ * under *bound and the reduction stops, returning at least *bound.
+ * *bound is shared between threads and read now and then.
+ */
+#define BOUND_STEP 4096
+
+static size_t reduce_without(const char *src, size_t len, char unit, char *dst,
+	const size_t *bound)
+{
+	size_t w = 0;
+	for (size_t r = 0; r < len; r++)
 	{
-		fprintf(stderr, "File %s not found\n", argv[1]);
-		return 1;
+		if (r % BOUND_STEP == 0)
+		{
+			size_t limit = __atomic_load_n(bound, __ATOMIC_RELAXED);
+			if (w >= limit + (len - r))
+			{
+				return limit;
+			}
+		}
+		if ((src[r] | 0x20) == unit)
+		{
+			continue;
+		}
+		w = push(dst, w, src[r]);
 	}
+	return w;
+}
+
+static int benchmark;
 
-	char *line = NULL;
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* time react() and every supported kernel on the polymer and check that they agree */
+static void reduce_bench(const char *str, FILE *report)
+{
+	size_t len = strlen(str);
+	char *buf = malloc(len + 1);
+	if (!buf)
+	{
+		return;
+	}
+	fprintf(report, "%-8s %12s %12s %10s\n", "reducer", "ms", "MB/s", "length");
+	size_t expect = 0;
+	for (size_t k = 0; k <= KERNELS; k++)
+	{
+		/* the scan first, then the kernels */
+		const struct kernel *kn = k ? kernels + k - 1 : NULL;
+		if (kn && !kn->supported())
+		{
+			continue;
+		}
+		uint64_t best = UINT64_MAX;
+		size_t reduced = 0;
+		for (int run = 0; run < 3; run++)
+		{
+			memcpy(buf, str, len + 1);
+			uint64_t start = now_ns();
+			reduced = kn ? kn->reduce(buf, len) : react(buf);
+			uint64_t end = now_ns();
+			best = best < end - start ? best : end - start;
+		}
+		fprintf(report, "%-8s %12.3f %12.1f %10zu%s\n", kn ? kn->name : "scan",
+			best / 1e6, best ? len * 1e3 / best : 0.0, reduced,
+			kn && reduced != expect ? " MISMATCH" : "");
+		expect = reduced;
+	}
+	free(buf);
+}
+
+/* the input and its reduction, done by the first part that needs it */
+struct polymer
+{
+	char *units;
+	size_t len;
+
+	pthread_mutex_t lock;	/* the parts may run at once */
+	int reduced_done;
+	char *reduced;
+	size_t reduced_len;
+};
+
+static int polymer_reduce(struct polymer *p)
+{
+	pthread_mutex_lock(&p->lock);
+	if (!p->reduced_done)
+	{
+		p->reduced = malloc(p->len + 1);
+		if (p->reduced)
+		{
+			memcpy(p->reduced, p->units, p->len);
+			p->reduced_len = kernel_get()->reduce(p->reduced, p->len);
+			p->reduced_done = 1;
+		}
+	}
+	pthread_mutex_unlock(&p->lock);
+	return p->reduced_done ? 0 : -1;
+}
+
+/*
+ * Part2 takes every unit out of the reduced polymer: the reactions left
+ * after taking a unit out are the same whether the rest was reduced
+ * before or not. On a long enough polymer the 26 reductions are tasks
+ * of a pool, each in a scratch buffer of its worker, and they share the
+ * shortest length found so far as the bound to give up at. The pool is
+ * the one part2 runs on, if any, or one of -j threads.
+ */
+#define PARALLEL_UNITS (1 << 14)
+
+struct removals
+{
+	const struct polymer *p;
+	struct pool *pool;
+	char *scratch;		/* reduced_len per worker, and one for outside */
+	size_t best;
+	size_t left;		/* reductions not done */
+};
+
+struct removal
+{
+	struct removals *r;
+	char unit;
+};
+
+static void removal_run(void *arg)
+{
+	const struct removal *j = arg;
+	struct removals *r = j->r;
+	int worker = r->pool ? pool_worker(r->pool) : -1;
+	char *dst = r->scratch + (size_t)(worker + 1) * r->p->reduced_len;
+	size_t len = reduce_without(r->p->reduced, r->p->reduced_len, j->unit, dst, &r->best);
+
+	size_t best = __atomic_load_n(&r->best, __ATOMIC_RELAXED);
+	while (len < best && !__atomic_compare_exchange_n(&r->best, &best, len, 0,
+		__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+	}
+	__atomic_sub_fetch(&r->left, 1, __ATOMIC_RELEASE);
+}
+
+/* -j threads for part2 outside of a pool, serial by default */
+static size_t threads = 1;
+
+static int part2(struct polymer *p, size_t *minlen)
+{
+	if (polymer_reduce(p) < 0)
+	{
+		return -1;
+	}
+	struct removals r = { .p = p, .best = p->reduced_len };
+
+	/* the most common units first, they tend to give the tighter bound */
+	size_t count[26] = {0};
+	for (size_t i = 0; i < p->reduced_len; i++)
+	{
+		unsigned u = (unsigned char)((p->reduced[i] | 0x20) - 'a');
+		if (u < 26)
+		{
+			count[u]++;
+		}
+	}
+	struct removal jobs[26];
+	size_t njobs = 0;
+	for (int u = 0; u < 26; u++)
+	{
+		if (!count[u])
+		{
+			continue;
+		}
+		size_t i = njobs++;
+		for (; i > 0 && count[jobs[i - 1].unit - 'a'] < count[u]; i--)
+		{
+			jobs[i] = jobs[i - 1];
+		}
+		jobs[i] = (struct removal){ &r, 'a' + u };
+	}
+
+	struct pool *own = NULL;
+	if (njobs > 1 && p->reduced_len >= PARALLEL_UNITS)
+	{
+		r.pool = pool_current();
+		if (!r.pool && threads != 1)
+		{
+			r.pool = own = pool_new(threads);
+		}
+	}
+	size_t workers = r.pool ? pool_size(r.pool) : 0;
+	r.scratch = malloc((workers + 1) * p->reduced_len + 1);
+	if (!r.scratch)
+	{
+		pool_free(own);
+		return -1;
+	}
+	r.left = njobs;
+	for (size_t i = 0; i < njobs; i++)
+	{
+		if (!r.pool || pool_submit(r.pool, removal_run, jobs + i) < 0)
+		{
+			removal_run(jobs + i);
+		}
+	}
+	if (r.pool)
+	{
+		pool_help(r.pool, &r.left);
+	}
+	pool_free(own);
+	free(r.scratch);
+	*minlen = r.best;
+	return 0;
+}
+
+static void *day5_parse(FILE *input)
+{
+	struct polymer *p = calloc(1, sizeof(*p));
+	if (!p)
+	{
+		return NULL;
+	}
 	size_t bufsize = 0;
-	if (getline(&line, &bufsize, input) == -1)
+	ssize_t linesize = getline(&p->units, &bufsize, input);
+	if (linesize == -1)
 	{
-		free(line);
-		fclose(input);
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		free(p->units);
+		free(p);
+		return NULL;
 	}
-	fclose(input);
 
 	/* chop off the terminal \n */
-	size_t linesize = strlen(line) - 1;
-	line[linesize] = 0;
+	if (linesize && p->units[linesize-1] == '\n')
+	{
+		p->units[--linesize] = 0;
+	}
+	p->len = linesize;
+	pthread_mutex_init(&p->lock, NULL);
+	return p;
+}
+
+static void day5_free(void *data)
+{
+	struct polymer *p = data;
+	pthread_mutex_destroy(&p->lock);
+	free(p->reduced);
+	free(p->units);
+	free(p);
+}
 
-	printf("Part1: %zu\n", part1(line));
-	printf("Part2: %zu\n", part2(line));
-	free(line);
+static int day5_option(int opt, const char *arg)
+{
+	if (opt == 'j')
+	{
+		long n = strtol(arg, NULL, 10);
+		threads = n > 0 ? n : 0;
+		return n > 0 ? 0 : -1;
+	}
+	if (opt == 'B')
+	{
+		benchmark = 1;
+		return 0;
+	}
+	for (size_t i = 0; i < KERNELS; i++)
+	{
+		if (!strcmp(arg, kernels[i].name) && kernels[i].supported())
+		{
+			kernel = kernels + i;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static int day5_part1(void *data, FILE *output)
+{
+	struct polymer *p = data;
+	if (benchmark)
+	{
+		reduce_bench(p->units, stderr);
+	}
+	if (polymer_reduce(p) < 0)
+	{
+		return -1;
+	}
+	fprintf(output, "%zu", p->reduced_len);
 	return 0;
 }
+
+static int day5_part2(void *data, FILE *output)
+{
+	size_t minlen;
+	if (part2(data, &minlen) < 0)
+	{
+		return -1;
+	}
+	fprintf(output, "%zu", minlen);
+	return 0;
+}
+
+const struct solver day5_solver = {
+	.name = "day5",
+	.options = "Bj:k:",
+	.usage = "[-B] [-j threads] [-k avx2|sse2|scalar]",
+	.option = day5_option,
+	.parse = day5_parse,
+	.free = day5_free,
+	.part1 = day5_part1,
+	.part2 = day5_part2,
+};
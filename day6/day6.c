@@ -1,6 +1,15 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "input.h"
+#include "pool.h"
+#include "solver.h"
 
 struct location
 {
@@ -47,7 +56,9 @@ static int region_init(struct region *out, struct location *l, size_t size)
 	out->y = y_min;
 	out->h = y_max - y_min + 1;
 
-	out->map = malloc(out->w * out->h * sizeof(out->map[0]));
+	/* aligned to cache lines, see rows_max_area() */
+	size_t bytes = (size_t)out->w * out->h * sizeof(out->map[0]);
+	out->map = aligned_alloc(64, (bytes + 63) / 64 * 64);
 	if (!out->map)
 	{
 		return -1;
@@ -117,37 +128,454 @@ static int region_max_area(struct region *r, const struct location *locs, size_t
 	return maxarea;
 }
 
-static int region_area_lt(struct region *r, const struct location *locs, size_t count, int limit)
+/*
+ * bfs: the nearest locations spread from all the locations at once, one
+ * distance at a time. A cell reached at distance d has for nearest
+ * locations those of its neighbours at distance d - 1, so it gets their
+ * label if they all agree and TIE otherwise. A label is final once the
+ * cell leaves the queue, where it is counted in the area of its
+ * location and marks the location infinite if the cell is on the
+ * border.
+ */
+#define UNSEEN -2
+#define TIE -1
+
+static int bfs_max_area(struct region *r, const struct location *locs, size_t count)
 {
-	for (int y = 0; y < r->h; y++)
+	size_t cells = (size_t)r->w * r->h;
+	int *dist = malloc(cells * sizeof(dist[0]));
+	int *queue = malloc(cells * sizeof(queue[0]));
+	int *area = calloc(count, sizeof(area[0]));
+	char *infinite = calloc(count, sizeof(infinite[0]));
+	int maxarea = -1;
+	if (!dist || !queue || !area || !infinite)
 	{
-		for (int x = 0; x < r->w; x++)
+		goto out;
+	}
+
+	for (size_t i = 0; i < cells; i++)
+	{
+		r->map[i] = UNSEEN;
+	}
+	size_t head = 0, tail = 0;
+	for (const struct location *l = locs; l < locs + count; l++)
+	{
+		int i = (l->y - r->y) * r->w + (l->x - r->x);
+		if (r->map[i] == UNSEEN)
 		{
-			int sum = 0;
-			for (const struct location *l = locs + count - 1;
-			     l >= locs;
-			     l--)
+			r->map[i] = l->id;
+			dist[i] = 0;
+			queue[tail++] = i;
+		}
+		else
+		{
+			r->map[i] = TIE;
+		}
+	}
+
+	while (head < tail)
+	{
+		int i = queue[head++];
+		int x = i % r->w;
+		int y = i / r->w;
+		int label = r->map[i];
+		if (label >= 0)
+		{
+			area[label]++;
+			if (x == 0 || x == r->w - 1 || y == 0 || y == r->h - 1)
+			{
+				infinite[label] = 1;
+			}
+		}
+
+		int next[4], n = 0;
+		if (x > 0) next[n++] = i - 1;
+		if (x < r->w - 1) next[n++] = i + 1;
+		if (y > 0) next[n++] = i - r->w;
+		if (y < r->h - 1) next[n++] = i + r->w;
+		while (n-->0)
+		{
+			int j = next[n];
+			if (r->map[j] == UNSEEN)
 			{
-				sum += distance(x + r->x - l->x, y + r->y - l->y);
+				r->map[j] = label;
+				dist[j] = dist[i] + 1;
+				queue[tail++] = j;
+			}
+			else if (dist[j] == dist[i] + 1 && r->map[j] != label)
+			{
+				r->map[j] = TIE;
 			}
-			r->map[y * r->w + x] = sum;
 		}
 	}
 
-	int area = 0;
-	for (int y = 0; y < r->h; y++)
+	maxarea = 0;
+	for (size_t i = 0; i < count; i++)
 	{
+		if (!infinite[i] && maxarea < area[i])
+		{
+			maxarea = area[i];
+		}
+	}
+out:
+	free(infinite);
+	free(area);
+	free(queue);
+	free(dist);
+	return maxarea;
+}
+
+/*
+ * rows: the scan again, with the map cut in bands of rows that are tasks
+ * of a pool. A band labels its rows, 8 cells at a time with AVX2, and
+ * tallies the areas and the border flags of the labels as it goes, in
+ * counters of its own that are added up at the end. Bands are whole
+ * multiples of 16 rows, which with the map aligned to 64 bytes keeps
+ * every cache line of the map within one band. The pool is the one the
+ * part runs on, if any, or one of -j threads, and is only used with
+ * more than one band per worker.
+ */
+#define BAND_ROWS 16
+
+struct bands
+{
+	const struct region *r;
+	const struct location *locs;
+	size_t count;
+	size_t rows;		/* per band */
+	int avx2;
+	int *area;		/* count per band */
+	char *infinite;		/* count per band */
+	size_t left;		/* bands not done */
+};
+
+struct band
+{
+	struct bands *b;
+	size_t index;
+};
+
+/* label of cell x of row y, the columns from x on */
+static void row_scalar(const struct region *r, const struct location *locs, size_t count,
+		       int y, int x, int *row)
+{
+	for (; x < r->w; x++)
+	{
+		int minlabel = TIE;
+		int mind = INT_MAX;
+		for (size_t i = 0; i < count; i++)
+		{
+			int d = distance(x + r->x - locs[i].x, y + r->y - locs[i].y);
+			if (d == mind)
+			{
+				minlabel = TIE;
+			}
+			else if (d < mind)
+			{
+				mind = d;
+				minlabel = locs[i].id;
+			}
+		}
+		row[x] = minlabel;
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static void row_avx2(const struct region *r, const struct location *locs, size_t count,
+		     int y, int *row)
+{
+	int x = 0;
+	for (; x + 8 <= r->w; x += 8)
+	{
+		const __m256i cx = _mm256_add_epi32(_mm256_set1_epi32(x + r->x),
+						    _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		__m256i mind = _mm256_set1_epi32(INT_MAX);
+		__m256i label = _mm256_set1_epi32(TIE);
+		for (size_t i = 0; i < count; i++)
+		{
+			int dy = y + r->y - locs[i].y;
+			__m256i d = _mm256_add_epi32(
+				_mm256_abs_epi32(_mm256_sub_epi32(cx, _mm256_set1_epi32(locs[i].x))),
+				_mm256_set1_epi32(dy > 0 ? dy : -dy));
+			__m256i tie = _mm256_cmpeq_epi32(d, mind);
+			__m256i closer = _mm256_cmpgt_epi32(mind, d);
+			mind = _mm256_min_epi32(mind, d);
+			label = _mm256_blendv_epi8(label, _mm256_set1_epi32(locs[i].id), closer);
+			/* TIE is all ones */
+			label = _mm256_or_si256(label, tie);
+		}
+		_mm256_storeu_si256((__m256i *)(row + x), label);
+	}
+	row_scalar(r, locs, count, y, x, row);
+}
+#endif
+
+static void band_run(void *arg)
+{
+	const struct band *j = arg;
+	struct bands *b = j->b;
+	const struct region *r = b->r;
+	int *area = b->area + j->index * b->count;
+	char *infinite = b->infinite + j->index * b->count;
+	int y1 = (j->index + 1) * b->rows < (size_t)r->h ? (j->index + 1) * b->rows : r->h;
+
+	for (int y = j->index * b->rows; y < y1; y++)
+	{
+		int *row = r->map + (size_t)y * r->w;
+#if defined(__x86_64__) || defined(__i386__)
+		if (b->avx2)
+		{
+			row_avx2(r, b->locs, b->count, y, row);
+		}
+		else
+#endif
+		{
+			row_scalar(r, b->locs, b->count, y, 0, row);
+		}
+
 		for (int x = 0; x < r->w; x++)
 		{
-			if (r->map[y * r->w + x] < limit)
+			if (row[x] >= 0)
 			{
-				area++;
+				area[row[x]]++;
 			}
 		}
+		if (y == 0 || y == r->h - 1)
+		{
+			for (int x = 0; x < r->w; x++)
+			{
+				if (row[x] >= 0)
+				{
+					infinite[row[x]] = 1;
+				}
+			}
+		}
+		else
+		{
+			if (row[0] >= 0)
+			{
+				infinite[row[0]] = 1;
+			}
+			if (row[r->w - 1] >= 0)
+			{
+				infinite[row[r->w - 1]] = 1;
+			}
+		}
+	}
+	__atomic_sub_fetch(&b->left, 1, __ATOMIC_RELEASE);
+}
+
+/* -j threads for the rows engine outside of a pool, serial by default */
+static size_t threads = 1;
+
+static int rows_max_area(struct region *r, const struct location *locs, size_t count)
+{
+	struct pool *own = NULL;
+	struct pool *pool = pool_current();
+	if (!pool && threads != 1 && (size_t)r->h > BAND_ROWS * threads)
+	{
+		pool = own = pool_new(threads);
+	}
+	if (pool && (size_t)r->h <= BAND_ROWS * pool_size(pool))
+	{
+		pool = NULL;
+	}
+	size_t workers = pool ? pool_size(pool) : 1;
+
+	/* a few bands per worker to even out the load */
+	struct bands b = { r, locs, count };
+#if defined(__x86_64__) || defined(__i386__)
+	b.avx2 = __builtin_cpu_supports("avx2");
+#endif
+	b.rows = (r->h + 4 * workers - 1) / (4 * workers);
+	b.rows = (b.rows + BAND_ROWS - 1) / BAND_ROWS * BAND_ROWS;
+	size_t nbands = (r->h + b.rows - 1) / b.rows;
+	b.area = calloc(nbands * count, sizeof(b.area[0]));
+	b.infinite = calloc(nbands * count, sizeof(b.infinite[0]));
+	struct band *jobs = malloc(nbands * sizeof(jobs[0]));
+	int maxarea = -1;
+	if (!b.area || !b.infinite || !jobs)
+	{
+		pool_free(own);
+		goto out;
+	}
+	b.left = nbands;
+	for (size_t i = 0; i < nbands; i++)
+	{
+		jobs[i] = (struct band){ &b, i };
+		if (!pool || pool_submit(pool, band_run, jobs + i) < 0)
+		{
+			band_run(jobs + i);
+		}
+	}
+	if (pool)
+	{
+		pool_help(pool, &b.left);
 	}
+	pool_free(own);
+
+	maxarea = 0;
+	for (size_t l = 0; l < count; l++)
+	{
+		int area = 0, infinite = 0;
+		for (size_t i = 0; i < nbands; i++)
+		{
+			area += b.area[i * count + l];
+			infinite |= b.infinite[i * count + l];
+		}
+		if (!infinite && maxarea < area)
+		{
+			maxarea = area;
+		}
+	}
+out:
+	free(jobs);
+	free(b.infinite);
+	free(b.area);
+	return maxarea;
+}
+
+/*
+ * sums: the distance sum splits along the axes, sum(|x - xi| + |y - yi|)
+ * = sx(x) + sy(y), and sx only needs the sorted xi: going from x to
+ * x + 1 adds one per location at or left of x and takes one per
+ * location right of it. Beyond the locations sx grows by count per
+ * step, so the cells under the limit are at most limit / count away
+ * from the bounding box, and the sums are taken over the box grown by
+ * that much on every side. Both axes are sorted, which is a merge as
+ * the sums decrease down to the median and increase after it, and the
+ * pairs under the limit are counted with two pointers.
+ */
+static int int_cmp(const void *d1, const void *d2)
+{
+	int a = *(const int *)d1;
+	int b = *(const int *)d2;
+	return (a > b) - (a < b);
+}
+
+/* sorted sums over [lo, hi] of the distances to the sorted c, NULL on error */
+static long long *axis_sums(const int *c, size_t count, int lo, int hi)
+{
+	size_t len = hi - lo + 1;
+	long long *sum = malloc(len * sizeof(sum[0]));
+	long long *sorted = malloc(len * sizeof(sorted[0]));
+	if (!sum || !sorted)
+	{
+		free(sorted);
+		free(sum);
+		return NULL;
+	}
+
+	long long s = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		s += c[i] - lo;
+	}
+	size_t below = 0;
+	size_t min = 0;
+	for (size_t k = 0; k < len; k++)
+	{
+		sum[k] = s;
+		if (sum[k] < sum[min])
+		{
+			min = k;
+		}
+		while (below < count && c[below] <= lo + (int)k)
+		{
+			below++;
+		}
+		s += (long long)below - (long long)(count - below);
+	}
+
+	/* merge the sums left of the minimum, backwards, with the rest */
+	size_t l = min, r = min, k = 0;
+	while (l > 0 || r < len)
+	{
+		if (r == len || (l > 0 && sum[l - 1] < sum[r]))
+		{
+			sorted[k++] = sum[--l];
+		}
+		else
+		{
+			sorted[k++] = sum[r++];
+		}
+	}
+	free(sum);
+	return sorted;
+}
+
+static int sums_area_lt(struct region *r, const struct location *locs, size_t count, int limit)
+{
+	int *xs = malloc(count * sizeof(xs[0]));
+	int *ys = malloc(count * sizeof(ys[0]));
+	long long *sx = NULL, *sy = NULL;
+	long long area = -1;
+	if (!xs || !ys)
+	{
+		goto out;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		xs[i] = locs[i].x;
+		ys[i] = locs[i].y;
+	}
+	qsort(xs, count, sizeof(xs[0]), int_cmp);
+	qsort(ys, count, sizeof(ys[0]), int_cmp);
+
+	int pad = limit / count + 1;
+	size_t w = r->w + 2 * pad;
+	size_t h = r->h + 2 * pad;
+	sx = axis_sums(xs, count, r->x - pad, r->x + r->w - 1 + pad);
+	sy = axis_sums(ys, count, r->y - pad, r->y + r->h - 1 + pad);
+	if (!sx || !sy)
+	{
+		goto out;
+	}
+
+	/* for each sx from the smallest, the sy that keep the sum under limit */
+	area = 0;
+	size_t j = h;
+	for (size_t i = 0; i < w && j > 0; i++)
+	{
+		while (j > 0 && sx[i] + sy[j - 1] >= limit)
+		{
+			j--;
+		}
+		area += j;
+	}
+	if (area > INT_MAX)
+	{
+		area = -1;
+	}
+out:
+	free(sy);
+	free(sx);
+	free(ys);
+	free(xs);
 	return area;
 }
 
+/*
+ * Engines for the parts, which return -1 on error. scan measures the
+ * distances from every cell to every location for part1. All of them
+ * count part2 from the separable sums.
+ */
+struct engine
+{
+	const char *name;
+	int (*max_area)(struct region *r, const struct location *locs, size_t count);
+	int (*area_lt)(struct region *r, const struct location *locs, size_t count, int limit);
+};
+
+static const struct engine engines[] = {
+	{ "bfs", bfs_max_area, sums_area_lt },
+	{ "rows", rows_max_area, sums_area_lt },
+	{ "scan", region_max_area, sums_area_lt },
+};
+
+static const struct engine *engine = engines;
+
 static void region_destroy(struct region *r)
 {
 	free(r->map);
@@ -155,12 +583,18 @@ static void region_destroy(struct region *r)
 	r->x = r->y = r->w = r->h = 0;
 }
 
-struct location *load_locations(FILE *input, size_t *count)
+static struct location *load_locations(FILE *input, size_t *count)
 {
+	struct input in;
+	*count = 0;
+	if (input_map(&in, input) < 0)
+	{
+		return NULL;
+	}
+
 	size_t size = 0;
 	struct location l, *pool = NULL;
-	*count = 0;
-	while (fscanf(input, " %d, %d", &l.x, &l.y) == 2)
+	while (input_next_int(&in, &l.x) && input_next_int(&in, &l.y))
 	{
 		l.id = *count;
 		l.skip = l.area = 0;
@@ -179,39 +613,103 @@ struct location *load_locations(FILE *input, size_t *count)
 		pool[*count] = l;
 		(*count)++;
 	}
+	input_unmap(&in);
 	return pool;
 }
 
-int main(int argc, char *argv[])
+struct data
 {
-	if (argc < 2)
+	struct location *locs;
+	size_t count;
+};
+
+static void *day6_parse(FILE *input)
+{
+	struct data *d = malloc(sizeof(*d));
+	if (d)
 	{
-		fprintf(stderr, "Usage: %s filename\n", argv[0]);
-		return 1;
+		d->locs = load_locations(input, &d->count);
+		if (!d->locs || !d->count)
+		{
+			free(d->locs);
+			free(d);
+			return NULL;
+		}
 	}
+	return d;
+}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+static void day6_free(void *data)
+{
+	struct data *d = data;
+	free(d->locs);
+	free(d);
+}
+
+static int day6_option(int opt, const char *arg)
+{
+	if (opt == 'j')
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		long n = strtol(arg, NULL, 10);
+		threads = n > 0 ? n : 0;
+		return n > 0 ? 0 : -1;
 	}
+	for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+	{
+		if (!strcmp(arg, engines[i].name))
+		{
+			engine = engines + i;
+			return 0;
+		}
+	}
+	return -1;
+}
 
-	size_t count;
-	struct location *locs = load_locations(input, &count);
-	fclose(input);
-
+static int day6_part1(void *data, FILE *output)
+{
+	struct data *d = data;
 	struct region r;
-	if (region_init(&r, locs, count) < 0)
+	if (region_init(&r, d->locs, d->count) < 0)
 	{
 		fprintf(stderr, "Cannot initialize the region\n");
-		free(locs);
-		return 1;
+		return -1;
 	}
-	printf("Part1: %d\n", region_max_area(&r, locs, count));
-	printf("Part2: %d\n", region_area_lt(&r, locs, count, 10000));
+	int area = engine->max_area(&r, d->locs, d->count);
 	region_destroy(&r);
-	free(locs);
+	if (area < 0)
+	{
+		return -1;
+	}
+	fprintf(output, "%d", area);
+	return 0;
+}
 
+static int day6_part2(void *data, FILE *output)
+{
+	struct data *d = data;
+	struct region r;
+	if (region_init(&r, d->locs, d->count) < 0)
+	{
+		fprintf(stderr, "Cannot initialize the region\n");
+		return -1;
+	}
+	int area = engine->area_lt(&r, d->locs, d->count, 10000);
+	region_destroy(&r);
+	if (area < 0)
+	{
+		return -1;
+	}
+	fprintf(output, "%d", area);
 	return 0;
 }
+
+const struct solver day6_solver = {
+	.name = "day6",
+	.options = "e:j:",
+	.usage = "[-e bfs|rows|scan] [-j threads]",
+	.option = day6_option,
+	.parse = day6_parse,
+	.free = day6_free,
+	.part1 = day6_part1,
+	.part2 = day6_part2,
+};
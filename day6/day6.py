@@ -60,17 +60,15 @@ class Region:
         return largest
 
     def find_area_lt(self, locs, limit):
-        for y in range(self.h):
-            for x in range(self.w):
+        # past the box every step adds len(locs) to the sum
+        pad = limit // len(locs) + 1
+        area = 0
+        for y in range(-pad, self.h + pad):
+            for x in range(-pad, self.w + pad):
                 dsum = 0
                 for l in locs:
                     dsum += distance(x+self.x-l.x, y+self.y-l.y)
-                self.m[y][x] = dsum
-
-        area = 0
-        for y in range(self.h):
-            for x in range(self.w):
-                if self.m[y][x] < limit:
+                if dsum < limit:
                     area += 1
         return area
 
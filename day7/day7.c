@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "solver.h"
+
 #define MAXSIZE 26
 
 struct Node
@@ -188,29 +190,38 @@ static void graph_schedule(struct Graph *g, size_t workers, char *buffer, int *t
 	*buffer = 0;
 }
 
-int main(int argc, char *argv[])
+static void *day7_parse(FILE *input)
 {
-	if (argc < 2)
+	struct Graph *g = malloc(sizeof(*g));
+	if (g)
 	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
+		graph_load(input, g);
 	}
+	return g;
+}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
-	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
-	}
-	struct Graph g;
-	graph_load(input, &g);
-	fclose(input);
+static int day7_part1(void *data, FILE *output)
+{
+	int time;
+	char buffer[MAXSIZE+1];
+	graph_schedule(data, 1, buffer, &time);
+	fprintf(output, "%s", buffer);
+	return 0;
+}
 
+static int day7_part2(void *data, FILE *output)
+{
 	int time;
-	char buffer[27];
-	graph_schedule(&g, 1, buffer, &time);
-	printf("Part1: %s\n", buffer);
-	graph_schedule(&g, 5, buffer, &time);
-	printf("Part2: %d\n", time);
+	char buffer[MAXSIZE+1];
+	graph_schedule(data, 5, buffer, &time);
+	fprintf(output, "%d", time);
 	return 0;
 }
+
+const struct solver day7_solver = {
+	.name = "day7",
+	.parse = day7_parse,
+	.free = free,
+	.part1 = day7_part1,
+	.part2 = day7_part2,
+};
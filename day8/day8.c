@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "solver.h"
+
 struct node
 {
 	struct node **children;
@@ -98,31 +100,32 @@ static int part2(struct node *n)
 	}
 }
 
-int main(int argc, char *argv[])
+static void *day8_parse(FILE *input)
 {
-	if (argc < 2)
-	{
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-		return 1;
-	}
+	return node_new(input);
+}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
-	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
-	}
+static void day8_free(void *data)
+{
+	node_free(data);
+}
 
-	struct node *root = node_new(input);
-	fclose(input);
-	if (!root)
-	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
-	}
+static int day8_part1(void *data, FILE *output)
+{
+	fprintf(output, "%d", part1(data));
+	return 0;
+}
 
-	printf("Part1: %d\n", part1(root));
-	printf("Part2: %d\n", part2(root));
-	node_free(root);
+static int day8_part2(void *data, FILE *output)
+{
+	fprintf(output, "%d", part2(data));
 	return 0;
 }
+
+const struct solver day8_solver = {
+	.name = "day8",
+	.parse = day8_parse,
+	.free = day8_free,
+	.part1 = day8_part1,
+	.part2 = day8_part2,
+};
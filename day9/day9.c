@@ -1,19 +1,67 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-static size_t game(size_t marbles, size_t players)
+#include "solver.h"
+
+/*
+ * State of a game, reused from one game to the next. The list engine
+ * keeps the circle as next/prev links indexed by marble. The ring
+ * engine keeps it as a deque of 32-bit marbles with the current
+ * marble at the back: placing a marble moves one marble from the
+ * front to the back and pushes the new one, the 23-rule moves seven
+ * from the back to the front, pops the back and moves one to the back
+ * again. Every access is at either end of the deque.
+ *
+ * The stream engine plays the same deque within a memory budget. Only
+ * the last marbles of the back are ever removed, so the back is a small
+ * stack; whatever sinks below it joins the tail of the front, unless
+ * the front is already longer than the marbles left to play can ever
+ * consume. Such marbles are retired: neither they nor anything placed
+ * behind them can reach either end again before the game is over.
+ */
+#define BACK_SIZE 128
+#define BACK_DEPTH 64
+
+struct arena
+{
+	size_t *next;
+	size_t *prev;
+	uint32_t *ring;
+	size_t mask;
+	uint64_t *score;
+
+	uint32_t back[BACK_SIZE];
+	size_t budget;		/* bytes the stream engine may use */
+	size_t peak;		/* bytes used at most by the last game */
+};
+
+struct engine
+{
+	const char *name;
+	int (*init)(struct arena *a, size_t marbles, size_t players);
+	int (*game)(struct arena *a, size_t marbles, size_t players);
+};
+
+static int list_init(struct arena *a, size_t marbles, size_t players)
+{
+	a->next = malloc((marbles + 1) * sizeof(a->next[0]));
+	a->prev = malloc((marbles + 1) * sizeof(a->prev[0]));
+	return a->next && a->prev ? 0 : -1;
+}
+
+static int list_game(struct arena *a, size_t marbles, size_t players)
 {
 	marbles++;
-	size_t *next = malloc(marbles * sizeof(next[0]));
-	size_t *prev = malloc(marbles * sizeof(prev[0]));
-	size_t *score = calloc(players, sizeof(score[0]));
-	if (!next || !prev || !score)
-	{
-		free(score);
-		free(prev);
-		free(next);
-		return 0;
-	}
+	size_t *next = a->next;
+	size_t *prev = a->prev;
+	uint64_t *score = a->score;
 	next[0] = prev[0] = 0;
 	size_t cur = 0;
 	size_t player = 0;
@@ -45,45 +93,520 @@ static size_t game(size_t marbles, size_t players)
 		}
 		player++;
 	}
-	size_t max = 0;
-	for (size_t i = 0; i < players; i++)
+	return 0;
+}
+
+static int ring_init(struct arena *a, size_t marbles, size_t players)
+{
+	if (marbles > UINT32_MAX)
+	{
+		return -1;
+	}
+	/* the circle never holds more than all the marbles */
+	size_t size = 16;
+	while (size < marbles + 1)
+	{
+		size *= 2;
+	}
+	a->mask = size - 1;
+	a->ring = malloc(size * sizeof(a->ring[0]));
+	return a->ring ? 0 : -1;
+}
+
+static int ring_game(struct arena *a, size_t marbles, size_t players)
+{
+	uint32_t *ring = a->ring;
+	size_t mask = a->mask;
+	uint64_t *score = a->score;
+	size_t head = 0, tail = 0;
+	ring[tail++] = 0;
+	size_t player = 0;
+	for (size_t i = 1; i <= marbles; i++)
 	{
-		if (max < score[i])
+		if (i % 23 == 0)
+		{
+			for (int j = 0; j < 7; j++)
+			{
+				ring[--head & mask] = ring[--tail & mask];
+			}
+			score[player] += ring[--tail & mask] + i;
+			ring[tail++ & mask] = ring[head++ & mask];
+		}
+		else
 		{
-			max = score[i];
+			ring[tail++ & mask] = ring[head++ & mask];
+			ring[tail++ & mask] = i;
+		}
+		if (++player == players)
+		{
+			player = 0;
 		}
 	}
-	free(score);
-	free(prev);
-	free(next);
-	return max;
+	return 0;
+}
+
+/* front entries the budget leaves room for */
+static size_t stream_limit(const struct arena *a, size_t players)
+{
+	size_t fixed = sizeof(a->back) + players * sizeof(a->score[0]);
+	return a->budget > fixed ? (a->budget - fixed) / sizeof(a->ring[0]) : 0;
 }
 
-int main(int argc, char *argv[])
+static int stream_init(struct arena *a, size_t marbles, size_t players)
 {
-	if (argc < 2)
+	if (marbles > UINT32_MAX)
 	{
-		fprintf(stderr, "Usage: %s filename\n", argv[0]);
-		return 1;
+		return -1;
 	}
+	size_t size = 1024;
+	while (size > 16 && size > stream_limit(a, players))
+	{
+		size /= 2;
+	}
+	a->mask = size - 1;
+	a->ring = malloc(size * sizeof(a->ring[0]));
+	return a->ring ? 0 : -1;
+}
 
-	FILE *input = fopen(argv[1], "rb");
-	if (!input)
+/* double the front, keeping the entries at the same absolute indexes */
+static int stream_grow(struct arena *a, size_t players, size_t head, size_t tail)
+{
+	size_t size = 2 * (a->mask + 1);
+	if (size > stream_limit(a, players))
+	{
+		return -1;
+	}
+	uint32_t *ring = malloc(size * sizeof(ring[0]));
+	if (!ring)
 	{
-		fprintf(stderr, "Cannot open %s\n", argv[1]);
-		return 1;
+		return -1;
 	}
+	for (size_t i = head; i != tail; i++)
+	{
+		ring[i & (size - 1)] = a->ring[i & a->mask];
+	}
+	free(a->ring);
+	a->ring = ring;
+	a->mask = size - 1;
+	return 0;
+}
 
-	size_t lastmarble, numplayers;
-	int r = fscanf(input, " %zu players; last marble is worth %zu points", &numplayers, &lastmarble);
-	fclose(input);
-	if (r != 2)
+static int stream_game(struct arena *a, size_t marbles, size_t players)
+{
+	uint32_t *back = a->back;
+	uint64_t *score = a->score;
+	size_t head = 0, tail = 0;	/* front in ring[head, tail) */
+	size_t bottom = 0, top = 0;	/* back in back[bottom, top) */
+	int retired = 0;
+	back[top++] = 0;
+	size_t player = 0;
+
+#define FRONT_ROOM() \
+	if (tail - head > a->mask && stream_grow(a, players, head, tail) < 0) \
+		return -1
+#define FRONT_POP() \
+	(head != tail ? a->ring[head++ & a->mask] : back[bottom++ % BACK_SIZE])
+#define BACK_POP() \
+	(top != bottom ? back[--top % BACK_SIZE] : a->ring[--tail & a->mask])
+
+	for (size_t i = 1; i <= marbles; i++)
 	{
-		fprintf(stderr, "Cannot parse the data\n");
-		return 1;
+		if (i % 23 == 0)
+		{
+			for (int j = 0; j < 7; j++)
+			{
+				uint32_t m = BACK_POP();
+				FRONT_ROOM();
+				a->ring[--head & a->mask] = m;
+			}
+			score[player] += BACK_POP() + i;
+			uint32_t m = FRONT_POP();
+			back[top++ % BACK_SIZE] = m;
+		}
+		else
+		{
+			uint32_t m = FRONT_POP();
+			back[top++ % BACK_SIZE] = m;
+			back[top++ % BACK_SIZE] = i;
+
+			/*
+			 * The front loses at most one marble per marble
+			 * played and gains seven on every 23rd.
+			 */
+			size_t left = marbles - i;
+			size_t reach = left - 7 * (left / 23) + 8;
+			while (top - bottom > BACK_DEPTH)
+			{
+				m = back[bottom++ % BACK_SIZE];
+				retired = retired || tail - head >= reach;
+				if (!retired)
+				{
+					FRONT_ROOM();
+					a->ring[tail++ & a->mask] = m;
+				}
+			}
+		}
+		if (++player == players)
+		{
+			player = 0;
+		}
 	}
 
-	printf("Part1: %zu\n", game(lastmarble, numplayers));
-	printf("Part2: %zu\n", game(lastmarble*100U, numplayers));
+#undef BACK_POP
+#undef FRONT_POP
+#undef FRONT_ROOM
+
+	a->peak = (a->mask + 1) * sizeof(a->ring[0]) + sizeof(a->back) +
+		players * sizeof(a->score[0]);
 	return 0;
 }
+
+static const struct engine engines[] = {
+	{ "ring", ring_init, ring_game },
+	{ "list", list_init, list_game },
+	{ "stream", stream_init, stream_game },
+};
+
+/* engine of the games, -e selects it and -m implies the stream */
+static const struct engine *engine = engines;
+static size_t budget = SIZE_MAX;
+
+static void arena_free(struct arena *a)
+{
+	free(a->score);
+	free(a->ring);
+	free(a->prev);
+	free(a->next);
+}
+
+/* room for any game up to the given size, returns 0 on success */
+static int arena_init(struct arena *a, size_t marbles, size_t players)
+{
+	memset(a, 0, sizeof(*a));
+	a->score = malloc(players * sizeof(a->score[0]));
+	a->budget = budget;
+	if (!a->score || engine->init(a, marbles, players) < 0)
+	{
+		arena_free(a);
+		return -1;
+	}
+	return 0;
+}
+
+/* highest score of the game, returns 0 on success */
+static int game(struct arena *a, size_t marbles, size_t players, uint64_t *max)
+{
+	memset(a->score, 0, players * sizeof(a->score[0]));
+	if (engine->game(a, marbles, players) < 0)
+	{
+		fprintf(stderr, "%zu marbles do not fit in %zu bytes\n", marbles, a->budget);
+		return -1;
+	}
+	if (engine->game == stream_game)
+	{
+		fprintf(stderr, "%zu marbles: peak %zu bytes, %.3f bytes/marble\n",
+			marbles, a->peak, (double)a->peak / (marbles + 1));
+	}
+	*max = 0;
+	for (size_t i = 0; i < players; i++)
+	{
+		if (*max < a->score[i])
+		{
+			*max = a->score[i];
+		}
+	}
+	return 0;
+}
+
+struct config
+{
+	size_t lastmarble;
+	size_t numplayers;
+};
+
+struct data
+{
+	struct config *pool;
+	size_t count;
+	size_t maxmarble;
+	size_t maxplayers;
+};
+
+/* -b plays every line of the input, on -j threads */
+static int batch;
+static long threads;
+
+/*
+ * Games of a batch. The workers take the games in input order and
+ * the results are printed in the same order as soon as they are known.
+ */
+struct batch
+{
+	const struct data *d;
+	size_t factor;
+
+	pthread_mutex_t lock;
+	pthread_cond_t done;	/* a game ended or a worker gave up */
+	size_t next;		/* next game to play */
+	uint64_t *result;
+	char *ended;		/* 1 once scored, 2 if the game failed */
+	size_t workers;		/* workers still playing */
+};
+
+static void *batch_worker(void *arg)
+{
+	struct batch *b = arg;
+	const struct data *d = b->d;
+	struct arena a;
+	int failed = arena_init(&a, d->maxmarble * b->factor, d->maxplayers) < 0;
+
+	pthread_mutex_lock(&b->lock);
+	while (!failed && b->next < d->count)
+	{
+		size_t i = b->next++;
+		pthread_mutex_unlock(&b->lock);
+
+		const struct config *c = d->pool + i;
+		uint64_t score;
+		int r = game(&a, c->lastmarble * b->factor, c->numplayers, &score);
+
+		pthread_mutex_lock(&b->lock);
+		b->result[i] = score;
+		b->ended[i] = r < 0 ? 2 : 1;
+		pthread_cond_broadcast(&b->done);
+	}
+	b->workers--;
+	pthread_cond_broadcast(&b->done);
+	pthread_mutex_unlock(&b->lock);
+
+	if (!failed)
+	{
+		arena_free(&a);
+	}
+	return NULL;
+}
+
+static int batch_run(const struct data *d, size_t factor, FILE *output)
+{
+	struct batch b = { .d = d, .factor = factor };
+	b.result = malloc(d->count * sizeof(b.result[0]));
+	b.ended = calloc(d->count, sizeof(b.ended[0]));
+	long n = threads > 0 ? threads : sysconf(_SC_NPROCESSORS_ONLN);
+	size_t count = n > 0 ? n : 1;
+	if (count > d->count)
+	{
+		count = d->count;
+	}
+	pthread_t *tid = malloc(count * sizeof(tid[0]));
+	if (!b.result || !b.ended || !tid)
+	{
+		free(tid);
+		free(b.ended);
+		free(b.result);
+		return -1;
+	}
+	pthread_mutex_init(&b.lock, NULL);
+	pthread_cond_init(&b.done, NULL);
+
+	pthread_mutex_lock(&b.lock);
+	for (; b.workers < count; b.workers++)
+	{
+		if (pthread_create(tid + b.workers, NULL, batch_worker, &b))
+		{
+			break;
+		}
+	}
+	size_t started = b.workers;
+
+	int r = 0;
+	for (size_t i = 0; r == 0 && i < d->count; i++)
+	{
+		while (!b.ended[i] && b.workers)
+		{
+			pthread_cond_wait(&b.done, &b.lock);
+		}
+		if (b.ended[i] != 1)
+		{
+			r = -1;
+			break;
+		}
+		pthread_mutex_unlock(&b.lock);
+		fprintf(output, "%s%" PRIu64, i ? "\n" : "", b.result[i]);
+		fflush(output);
+		pthread_mutex_lock(&b.lock);
+	}
+	pthread_mutex_unlock(&b.lock);
+
+	for (size_t i = 0; i < started; i++)
+	{
+		pthread_join(tid[i], NULL);
+	}
+	pthread_cond_destroy(&b.done);
+	pthread_mutex_destroy(&b.lock);
+	free(tid);
+	free(b.ended);
+	free(b.result);
+	return r;
+}
+
+static int play(const struct data *d, size_t factor, FILE *output)
+{
+	if (batch)
+	{
+		return batch_run(d, factor, output);
+	}
+
+	const struct config *c = d->pool;
+	struct arena a;
+	if (arena_init(&a, c->lastmarble * factor, c->numplayers) < 0)
+	{
+		return -1;
+	}
+	uint64_t score;
+	int r = game(&a, c->lastmarble * factor, c->numplayers, &score);
+	if (r == 0)
+	{
+		fprintf(output, "%" PRIu64, score);
+	}
+	arena_free(&a);
+	return r;
+}
+
+static int day9_option(int opt, const char *arg)
+{
+	switch (opt)
+	{
+	case 'e':
+		for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+		{
+			if (!strcmp(arg, engines[i].name))
+			{
+				engine = engines + i;
+				return 0;
+			}
+		}
+		return -1;
+	case 'j':
+		threads = strtol(arg, NULL, 10);
+		return threads > 0 ? 0 : -1;
+	case 'm':
+	{
+		/* bytes, with an optional K, M or G suffix */
+		char *end;
+		errno = 0;
+		unsigned long long bytes = strtoull(arg, &end, 10);
+		if (end == arg || *arg == '-' || errno == ERANGE)
+		{
+			return -1;
+		}
+		const char *units = "KMG";
+		long scale = 0;
+		if (*end)
+		{
+			const char *unit = strchr(units, *end);
+			if (!unit || end[1])
+			{
+				return -1;
+			}
+			scale = unit - units + 1;
+		}
+		while (scale-- > 0)
+		{
+			if (bytes > ULLONG_MAX / 1024)
+			{
+				return -1;
+			}
+			bytes *= 1024;
+		}
+		if (bytes == 0 || bytes > SIZE_MAX)
+		{
+			return -1;
+		}
+		budget = bytes;
+		engine = engines + 2;	/* stream */
+		return 0;
+	}
+	default:
+		batch = 1;
+		return 0;
+	}
+}
+
+static void day9_free(void *data)
+{
+	struct data *d = data;
+	if (d)
+	{
+		free(d->pool);
+		free(d);
+	}
+}
+
+/* one configuration per line, only the first one unless in batch mode */
+static void *day9_parse(FILE *input)
+{
+	struct data *d = calloc(1, sizeof(*d));
+	if (!d)
+	{
+		return NULL;
+	}
+	size_t size = 0;
+	struct config c;
+	while (fscanf(input, " %zu players; last marble is worth %zu points",
+		      &c.numplayers, &c.lastmarble) == 2)
+	{
+		if (c.numplayers == 0)
+		{
+			day9_free(d);
+			return NULL;
+		}
+		if (d->count == size)
+		{
+			size_t newsize = size ? size * 2 : 16;
+			struct config *newpool = realloc(d->pool, newsize * sizeof(newpool[0]));
+			if (!newpool)
+			{
+				day9_free(d);
+				return NULL;
+			}
+			d->pool = newpool;
+			size = newsize;
+		}
+		d->pool[d->count++] = c;
+		if (d->maxmarble < c.lastmarble)
+		{
+			d->maxmarble = c.lastmarble;
+		}
+		if (d->maxplayers < c.numplayers)
+		{
+			d->maxplayers = c.numplayers;
+		}
+	}
+	if (d->count == 0)
+	{
+		day9_free(d);
+		return NULL;
+	}
+	return d;
+}
+
+static int day9_part1(void *data, FILE *output)
+{
+	return play(data, 1, output);
+}
+
+static int day9_part2(void *data, FILE *output)
+{
+	return play(data, 100, output);
+}
+
+const struct solver day9_solver = {
+	.name = "day9",
+	.options = "be:j:m:",
+	.usage = "[-b] [-e ring|list|stream] [-j threads] [-m bytes[K|M|G]]",
+	.option = day9_option,
+	.parse = day9_parse,
+	.free = day9_free,
+	.part1 = day9_part1,
+	.part2 = day9_part2,
+};